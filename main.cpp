@@ -1,261 +1,7466 @@
-#include <iostream>
 #include <string>
 #include <fstream>
+#include <streambuf>
 #include <memory>
 #include <iterator>
 #include <bitset>
 #include <sstream>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <random>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <exception>
+#include <numeric>
+#include <limits>
+#include <chrono>
+#if __cplusplus >= 202002L
+#include <ranges>
+#include <span>
+#endif
+#include <stdexcept>
+#include <cstdlib>
+#include <cerrno>
+#include <functional>
+#include <typeinfo>
 
-/** @brief A basic virtual class for std::string encryption strategies. */
-class EncryptionStrategy
+#include "strategy_plugin.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <poll.h>
+#include <dlfcn.h>
+#include <signal.h>
+
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#define SFE_ZEROCOPY 1
+#endif
+
+// USDT probes (provider "sfe") for bpftrace/perf: a single nop at each site until attached.
+// Each probe has a semaphore, raised by the tracer while attached, so argument work that is
+// more than a load can be skipped with SFE_PROBE_ENABLED.
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#define SFE_PROBE(...) STAP_PROBEV(sfe, __VA_ARGS__)
+#define SFE_PROBE_SEMAPHORE(name) __extension__ volatile unsigned short sfe_##name##_semaphore __attribute__((unused, section(".probes")))
+SFE_PROBE_SEMAPHORE(strategy__entry);
+SFE_PROBE_SEMAPHORE(strategy__exit);
+SFE_PROBE_SEMAPHORE(chunk__dispatch);
+SFE_PROBE_SEMAPHORE(chunk__complete);
+SFE_PROBE_SEMAPHORE(io__submit);
+SFE_PROBE_SEMAPHORE(io__complete);
+#define SFE_PROBE_ENABLED(name) __builtin_expect(sfe_##name##_semaphore != 0, 0)
+#endif
+#endif
+#ifndef SFE_PROBE
+#define SFE_PROBE(...) ((void)0)
+#define SFE_PROBE_ENABLED(name) false
+#endif
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define SFE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/** @brief Byte-level kernels shared by the encryption strategies. */
+namespace kernels
 {
-public:
+    /** @brief Instruction set extensions the kernels dispatch on. */
+    struct CpuFeatures
+    {
+        bool avx2 = false;
+        bool avx512vbmi = false;
+    };
+
     /**
-     * @brief Pure virtual text (std::string) encryption method.
+     * @brief CPU features, detected on first use rather than at program start.
      * 
-     * @param text text to encrypt.
-     * @param key key string, empty by default.
-     * @return encrypted text.
+     * @return detected features.
      */
-    virtual std::string encrypt(const std::string &text, const std::string &key = "") = 0;
+    inline const CpuFeatures &cpu()
+    {
+        static const CpuFeatures features = []
+        {
+            CpuFeatures detected;
+#ifdef SFE_X86_SIMD
+            __builtin_cpu_init();
+            detected.avx2 = __builtin_cpu_supports("avx2");
+            detected.avx512vbmi = __builtin_cpu_supports("avx512vbmi") && __builtin_cpu_supports("avx512bw");
+#endif
+            return detected;
+        }();
+        return features;
+    }
+
+    /** @brief How the kernels store their output. */
+    enum class StoreMode
+    {
+        /**
+         * @brief Streaming stores for outputs larger than the last-level cache. Opt-in only: the
+         * slowdown of co-running processes that the threshold is meant to avoid has not been
+         * measured, so the threshold is unvalidated.
+         */
+        Auto,
+        /** @brief Always regular (cached) stores. */
+        Regular,
+        /** @brief Always streaming (non-temporal) stores. */
+        Streaming,
+    };
 
     /**
-     * @brief Pure virtual text (std::string) decryption method.
+     * @brief Parse a store mode name.
      * 
-     * @param text text to decrypt.
-     * @param key key string, empty by default.
-     * @return decrypted text.
+     * @param name "auto", "regular" or "streaming".
+     * @param mode receives the mode.
+     * @return false for an unknown name.
      */
-    virtual std::string decrypt(const std::string &text, const std::string &key = "") = 0;
-};
+    inline bool parseStoreMode(const std::string &name, StoreMode &mode)
+    {
+        if (name == "auto")
+            mode = StoreMode::Auto;
+        else if (name == "regular")
+            mode = StoreMode::Regular;
+        else if (name == "streaming")
+            mode = StoreMode::Streaming;
+        else
+            return false;
+        return true;
+    }
 
-/** @brief Concrete encryption strategy using XOR. 
- * Inherted from the base virtual class EncryptionStrategy. */
-class XOREncryptionStrategy : public EncryptionStrategy
-{
-public:
     /**
-     * @brief Text (std::string) encryption method using XOR.
+     * @brief Process-wide store mode, initially taken from SFE_STORES (so shard workers inherit it),
+     * regular stores otherwise.
      * 
-     * @param text text to encrypt.
-     * @param key key string.
-     * @return encrypted text by XOR.
+     * @return mode, which may be assigned at any time.
      */
-    std::string encrypt(const std::string &text, const std::string &key) override
+    inline std::atomic<StoreMode> &storeMode()
     {
-        if (key.empty())
-        {
-            return text;
-        }
+        static std::atomic<StoreMode> mode{[]
+                                           {
+                                               StoreMode parsed = StoreMode::Regular;
 
-        std::string output{text};
+                                               const char *name = std::getenv("SFE_STORES");
+                                               if (name)
+                                                   parseStoreMode(name, parsed);
+                                               return parsed;
+                                           }()};
+        return mode;
+    }
 
-        for (size_t i = 0; i < text.size(); i++)
+    /**
+     * @brief Decide the stores for one output buffer. Streaming stores bypass the cache, so an
+     * output that will not be read back soon does not evict the working set of the process
+     * and of other tenants of the last-level cache.
+     * 
+     * @param outputSize size of the whole output buffer.
+     * @return true if the kernels writing the buffer should use streaming stores.
+     */
+    inline bool wantsStreamingStores(size_t outputSize)
+    {
+        static const size_t threshold = []
         {
-            output[i] = text[i] ^ key[i % key.size()];
+            const long cache = ::sysconf(_SC_LEVEL3_CACHE_SIZE);
+            return cache > 0 ? size_t(cache) : size_t(32) << 20;
+        }();
+
+        switch (storeMode().load(std::memory_order_relaxed))
+        {
+        case StoreMode::Regular:
+            return false;
+        case StoreMode::Streaming:
+            return true;
+        default:
+            return outputSize >= threshold;
         }
+    }
 
-        return output;
+    /** @return true if kernels on this thread use streaming stores (see StreamingStoreScope). */
+    inline bool &streamingStores()
+    {
+        thread_local bool enabled = false;
+        return enabled;
     }
 
+    /** @brief Enable streaming stores for the kernels called on this thread within a scope. */
+    class StreamingStoreScope
+    {
+    public:
+        /**
+         * @brief Enter the scope.
+         *
+         * @param enable use streaming stores inside the scope.
+         */
+        explicit StreamingStoreScope(bool enable) : saved{streamingStores()} { streamingStores() = enable; }
+
+        StreamingStoreScope(const StreamingStoreScope &) = delete;
+        StreamingStoreScope &operator=(const StreamingStoreScope &) = delete;
+
+        ~StreamingStoreScope() { streamingStores() = saved; }
+
+    private:
+        bool saved;
+    };
+
+    /** @brief 256-entry byte substitution table (S-box). */
+    using ByteTable = std::array<std::uint8_t, 256>;
+
     /**
-     * @brief Text (std::string) decryption method using XOR.
-     * 
-     * @param text text to decrypt.
-     * @param key key string.
-     * @return decrypted text by XOR.
+     * @brief Scalar byte substitution, used for tails and on CPUs without SIMD support.
+     *
+     * @param table substitution table.
+     * @param in input bytes.
+     * @param out output bytes (may alias in).
+     * @param size number of bytes.
      */
-    std::string decrypt(const std::string &text, const std::string &key) override
+    inline void substituteScalar(const ByteTable &table, const char *in, char *out, size_t size)
     {
-        return encrypt(text, key);
+        for (size_t i = 0; i < size; i++)
+        {
+            out[i] = char(table[std::uint8_t(in[i])]);
+        }
     }
-};
 
-/**
- * @brief Concrete encryption strategy using Caesar. 
- * Inherted from the base virtual class EncryptionStrategy.
- */
-class CaesarEncryptionStrategy : public EncryptionStrategy
-{
-    const size_t ASCIISize = 255;
+#ifdef SFE_X86_SIMD
+    /** @brief Byte substitution with AVX-512 VBMI: two vpermi2b lookups selected by the top bit. */
+    __attribute__((target("avx512f,avx512bw,avx512vbmi"))) inline void substituteVBMI(const ByteTable &table, const char *in, char *out, size_t size)
+    {
+        const __m512i t0 = _mm512_loadu_si512(table.data());
+        const __m512i t1 = _mm512_loadu_si512(table.data() + 64);
+        const __m512i t2 = _mm512_loadu_si512(table.data() + 128);
+        const __m512i t3 = _mm512_loadu_si512(table.data() + 192);
+
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            const __m512i x = _mm512_loadu_si512(in + i);
+            const __m512i low = _mm512_permutex2var_epi8(t0, x, t1);
+            const __m512i high = _mm512_permutex2var_epi8(t2, x, t3);
+            _mm512_storeu_si512(out + i, _mm512_mask_blend_epi8(_mm512_movepi8_mask(x), low, high));
+        }
+
+        substituteScalar(table, in + i, out + i, size - i);
+    }
 
-public:
     /**
-     * @brief Text (std::string) encryption method using Caesar.
-     * 
-     * @param text text to encrypt.
-     * @param key key string.
-     * @return encrypted text by Caesar.
+     * @brief Byte substitution with AVX2: one pshufb per 16-entry row of the table,
+     * kept where the high nibble of the input selects that row.
      */
-    std::string encrypt(const std::string &text, const std::string &key) override
+    __attribute__((target("avx2"))) inline void substituteAVX2(const ByteTable &table, const char *in, char *out, size_t size)
     {
-        std::string temp{text};
-        auto shift = std::stoull(key);
+        __m256i rows[16];
+        for (int row = 0; row < 16; row++)
+        {
+            rows[row] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(table.data() + 16 * row)));
+        }
 
-        for (auto &ch : temp)
+        const __m256i nibbleMask = _mm256_set1_epi8(0x0f);
+
+        size_t i = 0;
+        for (; i + 32 <= size; i += 32)
         {
-            ch += char(shift % ASCIISize);
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+            const __m256i low = _mm256_and_si256(x, nibbleMask);
+            const __m256i high = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibbleMask);
+            __m256i result = _mm256_setzero_si256();
+
+            for (int row = 0; row < 16; row++)
+            {
+                const __m256i hit = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(char(row)));
+                result = _mm256_blendv_epi8(result, _mm256_shuffle_epi8(rows[row], low), hit);
+            }
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), result);
         }
 
-        return temp;
+        substituteScalar(table, in + i, out + i, size - i);
     }
+#endif
 
     /**
-     * @brief Text (std::string) decryption method using Caesar.
-     * 
-     * @param text text to decrypt.
-     * @param key key string.
-     * @return decrypted text by Caesar.
+     * @brief Byte substitution using the widest table-lookup kernel the CPU supports.
+     *
+     * @param table substitution table.
+     * @param in input bytes.
+     * @param out output bytes (may alias in).
+     * @param size number of bytes.
      */
-    std::string decrypt(const std::string &text, const std::string &key) override
+    inline void substitute(const ByteTable &table, const char *in, char *out, size_t size)
     {
-        std::string temp{text};
-        auto shift = std::stoull(key);
+        using Kernel = void (*)(const ByteTable &, const char *, char *, size_t);
+        static const Kernel kernel = []() -> Kernel
+        {
+#ifdef SFE_X86_SIMD
+            if (cpu().avx512vbmi)
+                return substituteVBMI;
+            if (cpu().avx2)
+                return substituteAVX2;
+#endif
+            return substituteScalar;
+        }();
+        kernel(table, in, out, size);
+    }
 
-        for (auto &ch : temp)
+    /** @brief FNV-1a offset basis, the hash of no bytes. */
+    constexpr std::uint64_t HashBasis = 14695981039346656037ull;
+
+    /**
+     * @brief FNV-1a hash of a byte range, continuing from a previous hash.
+     * 
+     * @param data bytes to hash.
+     * @param size number of bytes.
+     * @param hash hash of the preceding bytes.
+     * @return 64-bit hash.
+     */
+    inline std::uint64_t hashBytes(const char *data, size_t size, std::uint64_t hash = HashBasis)
+    {
+        for (size_t i = 0; i < size; i++)
         {
-            ch -= char(shift % ASCIISize);
+            hash = (hash ^ std::uint8_t(data[i])) * 1099511628211ull;
         }
+        return hash;
+    }
 
-        return temp;
+    /**
+     * @brief FNV-1a hash of a key string, used to seed key-dependent generators.
+     * 
+     * @param key key string.
+     * @return 64-bit hash.
+     */
+    inline std::uint64_t hashKey(const std::string &key)
+    {
+        return hashBytes(key.data(), key.size());
     }
-};
 
-/** @brief Concrete encryption strategy using Binary code. 
- * Inherted from the base virtual class EncryptionStrategy. */
-class BinaryEncryptionStrategy : public EncryptionStrategy
-{
-public:
     /**
-     * @brief Text (std::string) encryption method using Binary code.
+     * @brief splitmix64 step: advance the state and return the next 64-bit value.
      * 
-     * @param text text to encrypt.
-     * @return encrypted text by Binary code.
+     * @param state generator state.
+     * @return next pseudo-random value.
      */
-    std::string encrypt(const std::string &text, const std::string &) override
+    inline std::uint64_t splitmix64(std::uint64_t &state)
     {
-        std::stringstream temp;
+        std::uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
 
-        for (const auto &ch : text)
+    /** @brief Byte operation applied between the data and a repeating key pattern. */
+    enum class PatternOp
+    {
+        Xor,
+        Add
+    };
+
+    /**
+     * @brief Repeating key pattern (XOR key bytes or Caesar/Vigenere shifts).
+     *
+     * The key is repeated far enough past its period that a full vector can be
+     * loaded contiguously starting at any key phase, so the kernels never wrap
+     * inside a vector and never take a modulo on the hot path.
+     */
+    class RepeatingPattern
+    {
+    public:
+        /** @brief Widest vector the kernels load from the pattern. */
+        static constexpr size_t MaxLane = 64;
+
+        /**
+         * @brief Construct the pattern.
+         *
+         * @param key pattern bytes, one period.
+         */
+        explicit RepeatingPattern(const std::string &key) : keyPeriod{key.size()}
         {
-            std::bitset<8> bs(static_cast<unsigned long long>(ch));
-            temp << bs.to_string();
+            if (keyPeriod)
+            {
+                bytes.resize(keyPeriod + MaxLane);
+                for (size_t i = 0; i < bytes.size(); i++)
+                {
+                    bytes[i] = key[i % keyPeriod];
+                }
+            }
         }
 
-        return temp.str();
-    }
+        /** @return length of one period, 0 for an empty pattern. */
+        size_t period() const { return keyPeriod; }
+
+        /** @return expanded pattern bytes, valid for reads of MaxLane bytes from any phase. */
+        const char *data() const { return bytes.data(); }
+
+    private:
+        size_t keyPeriod;
+        std::string bytes;
+    };
 
     /**
-     * @brief Text (std::string) decryption method using Binary code.
-     * 
-     * @param text text to decrypt.
-     * @return decrypted text by Binary code.
+     * @brief Compare two repeating patterns over a common period, an empty pattern being a
+     * single zero byte.
+     *
+     * @param a first pattern, one period.
+     * @param b second pattern, one period.
+     * @param limit longest common period worth comparing.
+     * @return true if the patterns are equal at every position; false if not or if their
+     * common period exceeds limit.
      */
-    std::string decrypt(const std::string &text, const std::string &) override
+    inline bool samePattern(const std::string &a, const std::string &b, size_t limit = size_t(1) << 16)
     {
-        std::stringstream decoded;
+        const std::string zero(1, '\0');
+        const std::string &x = a.empty() ? zero : a;
+        const std::string &y = b.empty() ? zero : b;
 
-        for (std::string::const_iterator segmentIterator{text.begin()}; segmentIterator != text.end(); segmentIterator += 8)
+        const size_t period = x.size() / std::gcd(x.size(), y.size()) * y.size();
+        if (period > limit)
+            return false;
+
+        for (size_t i = 0; i < period; i++)
         {
-            std::string segment(segmentIterator, segmentIterator + 8);
-            auto ASCII = std::stoull(segment, nullptr, 2);
-            decoded << char(ASCII);
+            if (x[i % x.size()] != y[i % y.size()])
+                return false;
         }
+        return true;
+    }
 
-        return decoded.str();
+    /** @brief Combine one data byte with one pattern byte. */
+    template <PatternOp Op>
+    inline char applyOp(char data, char pattern)
+    {
+        if constexpr (Op == PatternOp::Xor)
+        {
+            return char(data ^ pattern);
+        }
+        else
+        {
+            return char(std::uint8_t(data) + std::uint8_t(pattern));
+        }
     }
-};
 
-/** @brief Interface for file encryption using text encryption strategies. */
-class IFileEncryptor
-{
-public:
     /**
-     * @brief Set the Strategy object.
-     * 
-     * @param strat strategy object to encrypt/decrypt with.
+     * @brief Scalar repeating-pattern kernel.
+     *
+     * @param pattern non-empty key pattern.
+     * @param in input bytes.
+     * @param out output bytes (may alias in).
+     * @param size number of bytes.
+     * @param phase key phase of the first byte, less than the pattern period.
      */
-    void setStrategy(EncryptionStrategy *strat)
+    template <PatternOp Op>
+    inline void applyPatternScalar(const RepeatingPattern &pattern, const char *in, char *out, size_t size, size_t phase)
     {
-        if (strat)
+        const char *key = pattern.data();
+        for (size_t i = 0; i < size; i++)
         {
-            strategy = strat;
+            out[i] = applyOp<Op>(in[i], key[phase]);
+            if (++phase == pattern.period())
+            {
+                phase = 0;
+            }
         }
     }
 
+#ifdef SFE_X86_SIMD
     /**
-     * @brief Text files encryption method.
-     * 
-     * @param filePathFrom path to the file from which the text is taken for encryption.
-     * @param filePathTo path to the file to which the ecrypted text will be written.
-     * @param key key string, empty by default.
-     * @return true if the encryption strategy object was initialized earlier and false otherwise.
+     * @brief Repeating-pattern kernel with AVX2, 32 bytes per step. The Stream variant aligns
+     * the output and writes it with non-temporal stores, fenced before returning.
      */
-    bool encrypt(const std::string &filePathFrom, const std::string &filePathTo, const std::string &key = "")
+    template <PatternOp Op, bool Stream = false>
+    __attribute__((target("avx2"))) inline void applyPatternAVX2(const RepeatingPattern &pattern, const char *in, char *out, size_t size, size_t phase)
     {
-        if (!strategy)
-            return false;
+        const size_t period = pattern.period();
+        const size_t step = 32 % period;
 
-        std::ofstream output(filePathTo, std::ios::trunc);
-        output << strategy->encrypt(getTextFromFile(filePathFrom), key);
+        size_t i = 0;
+        if constexpr (Stream)
+        {
+            i = std::min(size, (32 - reinterpret_cast<std::uintptr_t>(out) % 32) % 32);
+            applyPatternScalar<Op>(pattern, in, out, i, phase);
+            phase = (phase + i) % period;
+        }
 
-        return true;
+        for (; i + 32 <= size; i += 32)
+        {
+            const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+            const __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pattern.data() + phase));
+            const __m256i y = Op == PatternOp::Xor ? _mm256_xor_si256(x, k) : _mm256_add_epi8(x, k);
+            if constexpr (Stream)
+            {
+                _mm256_stream_si256(reinterpret_cast<__m256i *>(out + i), y);
+            }
+            else
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), y);
+            }
+
+            phase += step;
+            if (phase >= period)
+            {
+                phase -= period;
+            }
+        }
+
+        applyPatternScalar<Op>(pattern, in + i, out + i, size - i, phase);
+        if constexpr (Stream)
+        {
+            _mm_sfence();
+        }
     }
+#endif
 
     /**
-     * @brief Text files decryption method.
-     * 
-     * @param filePathFrom path to the file from which the text is taken for decryption.
-     * @param filePathTo path to the file to which the decrypted text will be written.
-     * @param key key string, empty by default.
-     * @return true if the encryption strategy object was initialized earlier and false otherwise.
+     * @brief Apply a repeating key pattern starting at an arbitrary stream offset.
+     *
+     * @param pattern key pattern; an empty pattern copies the input.
+     * @param in input bytes.
+     * @param out output bytes (may alias in).
+     * @param size number of bytes.
+     * @param offset position of the first byte in the whole stream (selects the key phase).
      */
-    bool decrypt(const std::string &filePathFrom, const std::string &filePathTo, const std::string &key = "")
+    template <PatternOp Op>
+    inline void applyPattern(const RepeatingPattern &pattern, const char *in, char *out, size_t size, size_t offset)
     {
-        if (!strategy)
-            return false;
+        if (!pattern.period())
+        {
+            if (in != out)
+            {
+                std::memmove(out, in, size);
+            }
+            return;
+        }
 
-        std::ofstream output(filePathTo, std::ios::trunc);
-        output << strategy->decrypt(getTextFromFile(filePathFrom), key);
+        using Kernel = void (*)(const RepeatingPattern &, const char *, char *, size_t, size_t);
+        static const Kernel kernel = []() -> Kernel
+        {
+#ifdef SFE_X86_SIMD
+            if (cpu().avx2)
+                return applyPatternAVX2<Op>;
+#endif
+            return applyPatternScalar<Op>;
+        }();
+        static const Kernel streaming = []() -> Kernel
+        {
+#ifdef SFE_X86_SIMD
+            if (cpu().avx2)
+                return applyPatternAVX2<Op, true>;
+#endif
+            return kernel;
+        }();
+        (streamingStores() ? streaming : kernel)(pattern, in, out, size, offset % pattern.period());
+    }
 
-        return true;
+    /**
+     * @brief Scalar binary expansion: eight '0'/'1' characters per byte, most significant bit first.
+     *
+     * @param in input bytes.
+     * @param out output characters, 8 * size of them.
+     * @param size number of input bytes.
+     */
+    inline void expandBitsScalar(const char *in, char *out, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            for (size_t bit = 0; bit < 8; bit++)
+            {
+                out[8 * i + bit] = char('0' + ((std::uint8_t(in[i]) >> (7 - bit)) & 1));
+            }
+        }
     }
 
-private:
-    /** @brief Text encryption strategy object. */
-    EncryptionStrategy *strategy;
+#ifdef SFE_X86_SIMD
+    /**
+     * @brief Binary expansion with AVX2, 4 input bytes to 32 characters per step: each byte is
+     * broadcast to eight lanes, tested against one bit per lane and turned into '0' or '1'.
+     * The Stream variant writes with non-temporal stores (fenced before returning) once the
+     * output is aligned; the 8x output is the largest any strategy writes.
+     */
+    template <bool Stream = false>
+    __attribute__((target("avx2"))) inline void expandBitsAVX2(const char *in, char *out, size_t size)
+    {
+        const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                                2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+        const __m256i bits = _mm256_set1_epi64x(0x0102040810204080ll);
+        const __m256i zero = _mm256_set1_epi8('0');
+
+        size_t i = 0;
+        bool aligned = false;
+        if constexpr (Stream)
+        {
+            if (reinterpret_cast<std::uintptr_t>(out) % 8 == 0)
+            {
+                for (; i < size && reinterpret_cast<std::uintptr_t>(out + 8 * i) % 32; i++)
+                {
+                    expandBitsScalar(in + i, out + 8 * i, 1);
+                }
+                aligned = true;
+            }
+        }
+
+        for (; i + 4 <= size; i += 4)
+        {
+            std::uint32_t word;
+            std::memcpy(&word, in + i, sizeof(word));
+            const __m256i x = _mm256_shuffle_epi8(_mm256_set1_epi32(int(word)), spread);
+            const __m256i set = _mm256_cmpeq_epi8(_mm256_and_si256(x, bits), bits);
+            const __m256i y = _mm256_sub_epi8(zero, set);
+            if (aligned)
+            {
+                _mm256_stream_si256(reinterpret_cast<__m256i *>(out + 8 * i), y);
+            }
+            else
+            {
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 8 * i), y);
+            }
+        }
+
+        expandBitsScalar(in + i, out + 8 * i, size - i);
+        if (aligned)
+        {
+            _mm_sfence();
+        }
+    }
+#endif
 
     /**
-     * @brief Get the text from file object.
-     * 
-     * @param filePath path to text file.
-     * @return std::string (text from file).
+     * @brief Binary expansion, eight '0'/'1' characters per byte, with streaming stores when
+     * enabled on this thread (see StreamingStoreScope).
+     *
+     * @param in input bytes.
+     * @param out output characters, 8 * size of them.
+     * @param size number of input bytes.
      */
-    std::string getTextFromFile(const std::string &filePath)
+    inline void expandBits(const char *in, char *out, size_t size)
     {
-        return std::string(
-            (std::istreambuf_iterator<char>(
-                *(std::unique_ptr<std::ifstream>(
-                      new std::ifstream(filePath)))
-                     .get())),
-            std::istreambuf_iterator<char>());
+        using Kernel = void (*)(const char *, char *, size_t);
+        static const Kernel kernel = []() -> Kernel
+        {
+#ifdef SFE_X86_SIMD
+            if (cpu().avx2)
+                return expandBitsAVX2<false>;
+#endif
+            return expandBitsScalar;
+        }();
+        static const Kernel streaming = []() -> Kernel
+        {
+#ifdef SFE_X86_SIMD
+            if (cpu().avx2)
+                return expandBitsAVX2<true>;
+#endif
+            return kernel;
+        }();
+        (streamingStores() ? streaming : kernel)(in, out, size);
     }
-};
 
-int main()
-{
-    const std::string key{"3abc"};
-    IFileEncryptor fileEncryptor;
+    /**
+     * @brief Binary packing, the inverse of expandBits: eight '0'/'1' characters per byte, the
+     * first being the most significant bit.
+     *
+     * @param in input characters, 8 * size of them.
+     * @param out output bytes.
+     * @param size number of output bytes.
+     * @return number of bytes packed; stops before the first group holding another character.
+     */
+    inline size_t packBits(const char *in, char *out, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            std::uint8_t byte = 0;
+            bool binary = true;
+            for (size_t bit = 0; bit < 8; bit++)
+            {
+                const char c = in[8 * i + bit];
+                binary &= c == '0' || c == '1';
+                byte = std::uint8_t(byte << 1 | (c & 1));
+            }
+            if (!binary)
+                return i;
+            out[i] = char(byte);
+        }
+        return size;
+    }
 
-    fileEncryptor.setStrategy(new XOREncryptionStrategy);
-    fileEncryptor.encrypt(".files/XOR/XOR_Original.txt", ".files/XOR/XOR_Crypted.txt", key);
-    fileEncryptor.decrypt(".files/XOR/XOR_Crypted.txt", ".files/XOR/XOR_Decrypted.txt", key);
+    /**
+     * @brief Philox4x32-10 counter-based generator.
+     *
+     * Block n of the keystream is a pure function of the key and n, so any chunk
+     * computes its keystream independently of the others.
+     */
+    class Philox
+    {
+    public:
+        /** @brief Bytes produced per counter value. */
+        static constexpr size_t BlockSize = 16;
 
-    fileEncryptor.setStrategy(new CaesarEncryptionStrategy);
-    fileEncryptor.encrypt(".files/Caesar/Caesar_Original.txt", ".files/Caesar/Caesar_Crypted.txt", key);
-    fileEncryptor.decrypt(".files/Caesar/Caesar_Crypted.txt", ".files/Caesar/Caesar_Decrypted.txt", key);
+        /**
+         * @brief Construct the generator from a key string.
+         * 
+         * @param key key string; hashed into the Philox key and the counter nonce.
+         */
+        explicit Philox(const std::string &key)
+        {
+            std::uint64_t state = hashKey(key);
+            const std::uint64_t seed = splitmix64(state);
+            const std::uint64_t nonce = splitmix64(state);
+            k0 = std::uint32_t(seed);
+            k1 = std::uint32_t(seed >> 32);
+            n0 = std::uint32_t(nonce);
+            n1 = std::uint32_t(nonce >> 32);
+        }
 
-    fileEncryptor.setStrategy(new BinaryEncryptionStrategy);
-    fileEncryptor.encrypt(".files/Binary/Binary_Original.txt", ".files/Binary/Binary_Crypted.txt");
-    fileEncryptor.decrypt(".files/Binary/Binary_Crypted.txt", ".files/Binary/Binary_Decrypted.txt");
+        /**
+         * @brief Construct the generator from raw Philox words, as in the Random123 test vectors.
+         * 
+         * @param key Philox key words.
+         * @param nonce upper two counter words; the lower two are the block index.
+         */
+        Philox(const std::array<std::uint32_t, 2> &key, const std::array<std::uint32_t, 2> &nonce)
+            : k0{key[0]}, k1{key[1]}, n0{nonce[0]}, n1{nonce[1]}
+        {
+        }
+
+        /**
+         * @brief Generate one keystream block.
+         * 
+         * @param block block index (stream offset / BlockSize).
+         * @param out BlockSize bytes of keystream.
+         */
+        void generate(std::uint64_t block, char *out) const
+        {
+            std::uint32_t c0 = std::uint32_t(block), c1 = std::uint32_t(block >> 32), c2 = n0, c3 = n1;
+            std::uint32_t key0 = k0, key1 = k1;
+
+            for (int round = 0; round < 10; round++)
+            {
+                const std::uint64_t p0 = std::uint64_t(M0) * c0;
+                const std::uint64_t p1 = std::uint64_t(M1) * c2;
+                const std::uint32_t next0 = std::uint32_t(p1 >> 32) ^ c1 ^ key0;
+                const std::uint32_t next2 = std::uint32_t(p0 >> 32) ^ c3 ^ key1;
+                c1 = std::uint32_t(p1);
+                c3 = std::uint32_t(p0);
+                c0 = next0;
+                c2 = next2;
+                key0 += W0;
+                key1 += W1;
+            }
+
+            const std::uint32_t words[4]{c0, c1, c2, c3};
+            std::memcpy(out, words, BlockSize);
+        }
+
+#ifdef SFE_X86_SIMD
+        /**
+         * @brief Generate eight consecutive keystream blocks with AVX2 and XOR them into the data.
+         * 
+         * @param block index of the first block.
+         * @param in 128 input bytes.
+         * @param out 128 output bytes (may alias in).
+         */
+        __attribute__((target("avx2"))) void xorEightBlocksAVX2(std::uint64_t block, const char *in, char *out) const
+        {
+            alignas(32) std::uint32_t low[8], high[8];
+            for (int lane = 0; lane < 8; lane++)
+            {
+                low[lane] = std::uint32_t(block + lane);
+                high[lane] = std::uint32_t((block + lane) >> 32);
+            }
+
+            __m256i c0 = _mm256_load_si256(reinterpret_cast<const __m256i *>(low));
+            __m256i c1 = _mm256_load_si256(reinterpret_cast<const __m256i *>(high));
+            __m256i c2 = _mm256_set1_epi32(int(n0));
+            __m256i c3 = _mm256_set1_epi32(int(n1));
+            __m256i key0 = _mm256_set1_epi32(int(k0));
+            __m256i key1 = _mm256_set1_epi32(int(k1));
+            const __m256i m0 = _mm256_set1_epi32(int(M0));
+            const __m256i m1 = _mm256_set1_epi32(int(M1));
+            const __m256i w0 = _mm256_set1_epi32(int(W0));
+            const __m256i w1 = _mm256_set1_epi32(int(W1));
+
+            for (int round = 0; round < 10; round++)
+            {
+                __m256i high0, low0, high1, low1;
+                mulHiLo(c0, m0, high0, low0);
+                mulHiLo(c2, m1, high1, low1);
+                const __m256i next0 = _mm256_xor_si256(_mm256_xor_si256(high1, c1), key0);
+                const __m256i next2 = _mm256_xor_si256(_mm256_xor_si256(high0, c3), key1);
+                c1 = low1;
+                c3 = low0;
+                c0 = next0;
+                c2 = next2;
+                key0 = _mm256_add_epi32(key0, w0);
+                key1 = _mm256_add_epi32(key1, w1);
+            }
+
+            // Transpose the four word vectors into eight 16-byte blocks.
+            const __m256i t0 = _mm256_unpacklo_epi32(c0, c1);
+            const __m256i t1 = _mm256_unpackhi_epi32(c0, c1);
+            const __m256i t2 = _mm256_unpacklo_epi32(c2, c3);
+            const __m256i t3 = _mm256_unpackhi_epi32(c2, c3);
+            const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+            const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+            const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+            const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+            const __m256i stream[4]{
+                _mm256_permute2x128_si256(u0, u1, 0x20),
+                _mm256_permute2x128_si256(u2, u3, 0x20),
+                _mm256_permute2x128_si256(u0, u1, 0x31),
+                _mm256_permute2x128_si256(u2, u3, 0x31)};
+
+            for (int i = 0; i < 4; i++)
+            {
+                const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + 32 * i));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + 32 * i), _mm256_xor_si256(x, stream[i]));
+            }
+        }
+#endif
+
+    private:
+        static constexpr std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+        static constexpr std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+
+        std::uint32_t k0, k1, n0, n1;
+
+#ifdef SFE_X86_SIMD
+        /** @brief 32x32->64 multiply of eight lanes, split into high and low words. */
+        __attribute__((target("avx2"))) static void mulHiLo(__m256i a, __m256i m, __m256i &high, __m256i &low)
+        {
+            const __m256i even = _mm256_mul_epu32(a, m);
+            const __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), m);
+            low = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+            high = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+        }
+#endif
+    };
+
+    /**
+     * @brief XOR data with the Philox keystream starting at an arbitrary stream offset.
+     * 
+     * @param generator keystream generator.
+     * @param in input bytes.
+     * @param out output bytes (may alias in).
+     * @param size number of bytes.
+     * @param offset position of the first byte in the whole stream.
+     */
+    inline void xorKeystream(const Philox &generator, const char *in, char *out, size_t size, size_t offset)
+    {
+        char block[Philox::BlockSize];
+
+        // Partial leading block up to the next block boundary.
+        if (const size_t skip = offset % Philox::BlockSize)
+        {
+            const size_t head = std::min(size, Philox::BlockSize - skip);
+            generator.generate(offset / Philox::BlockSize, block);
+            for (size_t i = 0; i < head; i++)
+            {
+                out[i] = char(in[i] ^ block[skip + i]);
+            }
+            in += head;
+            out += head;
+            size -= head;
+            offset += head;
+        }
+
+        std::uint64_t index = offset / Philox::BlockSize;
+        size_t i = 0;
+#ifdef SFE_X86_SIMD
+        if (cpu().avx2)
+        {
+            for (; i + 8 * Philox::BlockSize <= size; i += 8 * Philox::BlockSize, index += 8)
+            {
+                generator.xorEightBlocksAVX2(index, in + i, out + i);
+            }
+        }
+#endif
+        for (; i < size; i += Philox::BlockSize, index++)
+        {
+            generator.generate(index, block);
+            const size_t count = std::min(Philox::BlockSize, size - i);
+            for (size_t j = 0; j < count; j++)
+            {
+                out[i + j] = char(in[i + j] ^ block[j]);
+            }
+        }
+    }
+
+    /** @brief Scalar XOR of two byte streams into a third. */
+    inline void xorStreamsScalar(const char *a, const char *b, char *out, size_t size)
+    {
+        for (size_t i = 0; i < size; i++)
+        {
+            out[i] = char(a[i] ^ b[i]);
+        }
+    }
+
+#ifdef SFE_X86_SIMD
+    /** @brief XOR of two byte streams into a third with AVX2, 64 bytes per step. */
+    __attribute__((target("avx2"))) inline void xorStreamsAVX2(const char *a, const char *b, char *out, size_t size)
+    {
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            const __m256i a0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+            const __m256i a1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 32));
+            const __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i));
+            const __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + 32));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_xor_si256(a0, b0));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i + 32), _mm256_xor_si256(a1, b1));
+        }
+
+        xorStreamsScalar(a + i, b + i, out + i, size - i);
+    }
+#endif
+
+    /**
+     * @brief XOR two byte streams into a third (one-time pad).
+     *
+     * @param a first input.
+     * @param b second input.
+     * @param out output bytes (may alias a or b).
+     * @param size number of bytes.
+     */
+    inline void xorStreams(const char *a, const char *b, char *out, size_t size)
+    {
+        using Kernel = void (*)(const char *, const char *, char *, size_t);
+        static const Kernel kernel = []() -> Kernel
+        {
+#ifdef SFE_X86_SIMD
+            if (cpu().avx2)
+                return xorStreamsAVX2;
+#endif
+            return xorStreamsScalar;
+        }();
+        kernel(a, b, out, size);
+    }
+
+    /**
+     * @brief Scalar search for the first differing byte, used for tails and on CPUs without SIMD support.
+     *
+     * @param a first buffer.
+     * @param b second buffer.
+     * @param size number of bytes to compare.
+     * @return index of the first difference, or size if the buffers are equal.
+     */
+    inline size_t firstDifferenceScalar(const char *a, const char *b, size_t size)
+    {
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8)
+        {
+            std::uint64_t x, y;
+            std::memcpy(&x, a + i, sizeof(x));
+            std::memcpy(&y, b + i, sizeof(y));
+            if (x != y)
+                break;
+        }
+        for (; i < size && a[i] == b[i]; i++)
+            ;
+        return i;
+    }
+
+#ifdef SFE_X86_SIMD
+    /** @brief First differing byte with AVX2, 64 bytes per step. */
+    __attribute__((target("avx2"))) inline size_t firstDifferenceAVX2(const char *a, const char *b, size_t size)
+    {
+        size_t i = 0;
+        for (; i + 64 <= size; i += 64)
+        {
+            const __m256i low = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i)),
+                                                  _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i)));
+            const __m256i high = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i + 32)),
+                                                   _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + i + 32)));
+            const std::uint64_t equal = std::uint64_t(std::uint32_t(_mm256_movemask_epi8(low))) |
+                                        std::uint64_t(std::uint32_t(_mm256_movemask_epi8(high))) << 32;
+            if (~equal)
+            {
+                return i + size_t(__builtin_ctzll(~equal));
+            }
+        }
+        return i + firstDifferenceScalar(a + i, b + i, size - i);
+    }
+#endif
+
+    /**
+     * @brief Find the first differing byte of two buffers.
+     *
+     * @param a first buffer.
+     * @param b second buffer.
+     * @param size number of bytes to compare.
+     * @return index of the first difference, or size if the buffers are equal.
+     */
+    inline size_t firstDifference(const char *a, const char *b, size_t size)
+    {
+        using Kernel = size_t (*)(const char *, const char *, size_t);
+        static const Kernel kernel = []() -> Kernel
+        {
+#ifdef SFE_X86_SIMD
+            if (cpu().avx2)
+                return firstDifferenceAVX2;
+#endif
+            return firstDifferenceScalar;
+        }();
+        return kernel(a, b, size);
+    }
+
+    /** @brief Keys at least this long are XORed in place instead of being expanded into a RepeatingPattern. */
+    constexpr size_t LongKeySize = 1024;
+
+    /** @brief Data block walked per step of the long-key kernel; the next key block is prefetched meanwhile. */
+    constexpr size_t LongKeyBlock = 4096;
+
+    /**
+     * @brief XOR with a long repeating key, without a modulo or key copy on the hot path.
+     *
+     * Data and key are walked together in blocks aligned to LongKeyBlock stream offsets,
+     * each block being one contiguous run of key bytes handed to xorStreams; the key
+     * phase only wraps at the end of the key.
+     * 
+     * @param key key bytes.
+     * @param keySize key length, non-zero.
+     * @param in input bytes.
+     * @param out output bytes (may alias in).
+     * @param size number of bytes.
+     * @param offset position of the first byte in the whole stream.
+     */
+    inline void xorLongKey(const char *key, size_t keySize, const char *in, char *out, size_t size, size_t offset)
+    {
+        size_t phase = offset % keySize;
+
+        while (size)
+        {
+            const size_t run = std::min({size, keySize - phase, LongKeyBlock - offset % LongKeyBlock});
+
+            // Prefetch the key block used by the next step while this one is XORed.
+            const size_t nextPhase = phase + run == keySize ? 0 : phase + run;
+            const size_t nextRun = std::min(LongKeyBlock, keySize - nextPhase);
+            for (size_t line = 0; line < nextRun; line += 64)
+            {
+                __builtin_prefetch(key + nextPhase + line);
+            }
+
+            xorStreams(in, key + phase, out, run);
+
+            in += run;
+            out += run;
+            size -= run;
+            offset += run;
+            phase = nextPhase;
+        }
+    }
+
+    /**
+     * @brief Scanner for one needle encrypted at every key phase (Teddy-style filter).
+     *
+     * Pattern p is the needle as it appears in the ciphertext when it starts at a stream
+     * offset o with o % period == p. Patterns are spread over eight buckets (p % 8); per
+     * 32 input bytes the AVX2 filter looks up the high and low nibbles of the first two
+     * bytes in bucket bitmask tables (pshufb), and only offsets whose bucket bit for
+     * their own phase survives are compared in full.
+     */
+    class PhasedNeedleScanner
+    {
+    public:
+        /**
+         * @brief Construct the scanner.
+         * 
+         * @param patterns period patterns of patternSize bytes each, pattern p at p * patternSize.
+         * @param patternSize needle length, non-zero.
+         * @param period number of patterns (key period), non-zero.
+         */
+        PhasedNeedleScanner(std::string patterns, size_t patternSize, size_t period)
+            : patterns{std::move(patterns)}, patternSize{patternSize}, period{period}
+        {
+            for (size_t p = 0; p < period; p++)
+            {
+                const std::uint8_t bucket = std::uint8_t(1u << (p % 8));
+                const auto first = std::uint8_t(pattern(p)[0]);
+                low[0][first & 15] |= bucket;
+                high[0][first >> 4] |= bucket;
+                const auto second = patternSize > 1 ? std::uint8_t(pattern(p)[1]) : 0;
+                low[1][patternSize > 1 ? second & 15 : 0] |= bucket;
+                high[1][patternSize > 1 ? second >> 4 : 0] |= bucket;
+            }
+
+            // One-byte needles: the second-byte filter lets every byte through.
+            if (patternSize == 1)
+            {
+                low[1].fill(0xff);
+                high[1].fill(0xff);
+            }
+        }
+
+        /**
+         * @brief Find the needle at start offsets [begin, end) of the data.
+         * 
+         * @param data whole ciphertext, starting at stream offset 0.
+         * @param size ciphertext size.
+         * @param begin first start offset to test.
+         * @param end start offset past the last one to test.
+         * @param matches receives the matching start offsets, in increasing order.
+         */
+        void scan(const char *data, size_t size, size_t begin, size_t end, std::vector<size_t> &matches) const
+        {
+            if (size < patternSize)
+                return;
+            end = std::min(end, size - patternSize + 1);
+
+#ifdef SFE_X86_SIMD
+            if (cpu().avx2)
+            {
+                begin = scanAVX2(data, size, begin, end, matches);
+            }
+#endif
+            for (size_t offset = begin; offset < end; offset++)
+            {
+                check(data, offset, matches);
+            }
+        }
+
+    private:
+        std::string patterns;
+        size_t patternSize;
+        size_t period;
+        std::array<std::array<std::uint8_t, 16>, 2> low{}, high{};
+
+        const char *pattern(size_t phase) const { return patterns.data() + phase * patternSize; }
+
+        void check(const char *data, size_t offset, std::vector<size_t> &matches) const
+        {
+            const char *expected = pattern(offset % period);
+            if (data[offset] == expected[0] && std::memcmp(data + offset, expected, patternSize) == 0)
+            {
+                matches.push_back(offset);
+            }
+        }
+
+#ifdef SFE_X86_SIMD
+        /** @brief Filter 32 start offsets per step; returns the first offset left to the scalar tail. */
+        __attribute__((target("avx2"))) size_t scanAVX2(const char *data, size_t size, size_t begin, size_t end, std::vector<size_t> &matches) const
+        {
+            const __m256i low0 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(low[0].data())));
+            const __m256i high0 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(high[0].data())));
+            const __m256i low1 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(low[1].data())));
+            const __m256i high1 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(high[1].data())));
+            const __m256i nibble = _mm256_set1_epi8(0x0f);
+            alignas(32) std::uint8_t candidates[32];
+
+            size_t offset = begin;
+            for (; offset + 32 <= end && offset + 33 <= size; offset += 32)
+            {
+                const __m256i x0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + offset));
+                const __m256i x1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + offset + 1));
+                const __m256i first = _mm256_and_si256(
+                    _mm256_shuffle_epi8(low0, _mm256_and_si256(x0, nibble)),
+                    _mm256_shuffle_epi8(high0, _mm256_and_si256(_mm256_srli_epi16(x0, 4), nibble)));
+                const __m256i second = _mm256_and_si256(
+                    _mm256_shuffle_epi8(low1, _mm256_and_si256(x1, nibble)),
+                    _mm256_shuffle_epi8(high1, _mm256_and_si256(_mm256_srli_epi16(x1, 4), nibble)));
+                const __m256i buckets = _mm256_and_si256(first, second);
+
+                auto mask = ~std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(buckets, _mm256_setzero_si256())));
+                if (!mask)
+                    continue;
+
+                _mm256_store_si256(reinterpret_cast<__m256i *>(candidates), buckets);
+                while (mask)
+                {
+                    const int lane = __builtin_ctz(mask);
+                    mask &= mask - 1;
+                    const size_t candidate = offset + size_t(lane);
+                    if (candidates[lane] & (1u << (candidate % period % 8)))
+                    {
+                        check(data, candidate, matches);
+                    }
+                }
+            }
+            return offset;
+        }
+#endif
+    };
+}
+
+/**
+ * @brief Optional timeline recording of the pipeline, exported as Chrome trace JSON
+ * (chrome://tracing, ui.perfetto.dev).
+ *
+ * Every thread appends complete events to its own ring, which only that thread writes, so
+ * recording takes no lock; the oldest events are overwritten when a ring is full. While
+ * recording is off a Span costs one relaxed load and a branch.
+ */
+namespace trace
+{
+    /** @brief Events kept per thread. */
+    constexpr size_t RingCapacity = size_t(1) << 16;
+
+    /** @brief One complete event; names are string literals. */
+    struct Event
+    {
+        const char *name = nullptr;
+        std::uint64_t begin = 0;
+        std::uint64_t duration = 0;
+        std::uint64_t bytes = 0;
+    };
+
+    /** @brief Events of one thread: written by that thread only, read after the jobs finish. */
+    struct Ring
+    {
+        size_t thread = 0;
+        bool inUse = false;
+        std::atomic<std::uint64_t> head{0};
+        std::array<Event, RingCapacity> events;
+    };
+
+    /** @brief Event of a thread that has exited. */
+    struct FinishedEvent
+    {
+        size_t thread;
+        Event event;
+    };
+
+    /** @brief Process-wide recorder state. */
+    struct Recorder
+    {
+        std::atomic<bool> enabled{false};
+        std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        std::string path;
+        std::mutex mutex;
+        /** @brief Every ring, in use or free; a ring is only allocated when none is free. */
+        std::vector<std::unique_ptr<Ring>> rings;
+        std::vector<Ring *> freeRings;
+        /** @brief Events copied out of the rings of exited threads. */
+        std::vector<FinishedEvent> finished;
+        size_t threads = 0;
+    };
+
+    /** @return recorder; events of exited threads are kept so late dumps still see them. */
+    inline Recorder &recorder()
+    {
+        static Recorder instance;
+        return instance;
+    }
+
+    /** @return true while events are recorded. */
+    inline bool enabled()
+    {
+        return recorder().enabled.load(std::memory_order_relaxed);
+    }
+
+    /** @return nanoseconds since the recorder was created. */
+    inline std::uint64_t now()
+    {
+        return std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - recorder().origin).count());
+    }
+
+    /**
+     * @brief A thread's hold on a ring. When the thread exits, the ring's events are copied to
+     * the recorder and the ring goes back to the free list, so threads started per job
+     * reuse rings instead of allocating one each.
+     */
+    class RingLease
+    {
+    public:
+        RingLease()
+        {
+            Recorder &state = recorder();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (state.freeRings.empty())
+            {
+                state.rings.emplace_back(new Ring);
+                own = state.rings.back().get();
+            }
+            else
+            {
+                own = state.freeRings.back();
+                state.freeRings.pop_back();
+            }
+            own->thread = ++state.threads;
+            own->inUse = true;
+            own->head.store(0, std::memory_order_relaxed);
+        }
+
+        RingLease(const RingLease &) = delete;
+        RingLease &operator=(const RingLease &) = delete;
+
+        ~RingLease()
+        {
+            Recorder &state = recorder();
+            std::lock_guard<std::mutex> lock(state.mutex);
+            const std::uint64_t head = own->head.load(std::memory_order_relaxed);
+            for (std::uint64_t i = head > RingCapacity ? head - RingCapacity : 0; i < head; i++)
+            {
+                state.finished.push_back({own->thread, own->events[i % RingCapacity]});
+            }
+            own->inUse = false;
+            state.freeRings.push_back(own);
+        }
+
+        /** @return the leased ring. */
+        Ring &get() const { return *own; }
+
+    private:
+        Ring *own;
+    };
+
+    /** @return ring of the calling thread, leased on first use. */
+    inline Ring &ring()
+    {
+        thread_local RingLease lease;
+        return lease.get();
+    }
+
+    /**
+     * @brief Append an event to the calling thread's ring.
+     * 
+     * @param name event name, a string literal.
+     * @param begin start time from now().
+     * @param bytes bytes handled, 0 if not applicable.
+     */
+    inline void record(const char *name, std::uint64_t begin, std::uint64_t bytes)
+    {
+        Ring &own = ring();
+        const std::uint64_t head = own.head.load(std::memory_order_relaxed);
+        own.events[head % RingCapacity] = {name, begin, now() - begin, bytes};
+        own.head.store(head + 1, std::memory_order_release);
+    }
+
+    /** @brief Scoped event: from construction to destruction, recorded only while enabled. */
+    class Span
+    {
+    public:
+        /**
+         * @brief Start the event.
+         * 
+         * @param name event name, a string literal.
+         * @param bytes bytes handled, 0 if not applicable.
+         */
+        explicit Span(const char *name, std::uint64_t bytes = 0) : name{enabled() ? name : nullptr}, bytes{bytes}
+        {
+            if (this->name)
+            {
+                begin = now();
+            }
+        }
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+        ~Span()
+        {
+            if (name)
+            {
+                record(name, begin, bytes);
+            }
+        }
+
+    private:
+        const char *name;
+        std::uint64_t bytes;
+        std::uint64_t begin = 0;
+    };
+
+    /**
+     * @brief Write the recorded events as Chrome trace JSON. Call once the traced jobs are done.
+     * 
+     * @param path output path.
+     * @return true if the file was written.
+     */
+    inline bool writeChromeJson(const std::string &path)
+    {
+        Recorder &state = recorder();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        std::ofstream output(path, std::ios::trunc);
+        const long pid = long(::getpid());
+        output << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+        bool first = true;
+        const auto write = [&](size_t thread, const Event &event)
+        {
+            char line[256];
+            std::snprintf(line, sizeof(line), "%s\n{\"name\":\"%s\",\"cat\":\"sfe\",\"ph\":\"X\",\"pid\":%ld,\"tid\":%zu,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"bytes\":%llu}}",
+                          first ? "" : ",", event.name, pid, thread, double(event.begin) / 1000, double(event.duration) / 1000,
+                          static_cast<unsigned long long>(event.bytes));
+            output << line;
+            first = false;
+        };
+        for (const auto &finished : state.finished)
+        {
+            write(finished.thread, finished.event);
+        }
+        for (const auto &own : state.rings)
+        {
+            if (!own->inUse)
+                continue;
+            const std::uint64_t head = own->head.load(std::memory_order_acquire);
+            for (std::uint64_t i = head > RingCapacity ? head - RingCapacity : 0; i < head; i++)
+            {
+                write(own->thread, own->events[i % RingCapacity]);
+            }
+        }
+        output << "\n]}\n";
+
+        return bool(output.flush());
+    }
+
+    /** @brief Write the trace to the path given to start(); registered with atexit. */
+    inline void flush()
+    {
+        Recorder &state = recorder();
+        if (state.enabled.exchange(false) && !writeChromeJson(state.path))
+        {
+            std::fprintf(stderr, "cannot write trace %s\n", state.path.c_str());
+        }
+    }
+
+    /**
+     * @brief Start recording; the trace is written to path when the process exits.
+     * 
+     * @param path output path.
+     */
+    inline void start(const std::string &path)
+    {
+        Recorder &state = recorder();
+        state.path = path;
+        if (!state.enabled.exchange(true))
+        {
+            // Registered after the recorder exists, so it runs before the recorder is destroyed.
+            std::atexit(flush);
+        }
+    }
+}
+
+/** @brief Splitting of work across hardware threads. */
+namespace parallel
+{
+    /** @brief Smallest range worth handing to a separate thread. */
+    constexpr size_t MinChunkSize = size_t(1) << 20;
+
+    /**
+     * @brief Run fn over [0, size) split into contiguous ranges, one per hardware thread.
+     * An exception thrown by fn on any thread (a strategy rejecting its key) is rethrown on
+     * the calling thread once every range has returned.
+     *
+     * @param size total number of bytes.
+     * @param fn callable taking (begin, end) byte offsets.
+     * @param threads number of ranges; 0 picks one per hardware thread, at least MinChunkSize each.
+     */
+    template <typename Fn>
+    void forChunks(size_t size, Fn &&fn, size_t threads = 0)
+    {
+        if (threads)
+        {
+            threads = std::min(threads, std::max<size_t>(1, size));
+        }
+        else
+        {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+            threads = std::min(threads, std::max<size_t>(1, size / MinChunkSize));
+        }
+
+        if (threads == 1)
+        {
+            fn(size_t(0), size);
+            return;
+        }
+
+        const size_t chunk = (size + threads - 1) / threads;
+        std::mutex failureMutex;
+        std::exception_ptr failure;
+        const auto run = [&](size_t begin, size_t end)
+        {
+            try
+            {
+                fn(begin, end);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure)
+                    failure = std::current_exception();
+            }
+        };
+
+        std::vector<std::thread> workers;
+        for (size_t begin = chunk; begin < size; begin += chunk)
+        {
+            workers.emplace_back(run, begin, std::min(size, begin + chunk));
+        }
+
+        run(size_t(0), std::min(size, chunk));
+
+        {
+            trace::Span wait("wait workers");
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+        }
+        if (failure)
+            std::rethrow_exception(failure);
+    }
+}
+
+/** @brief A basic virtual class for std::string encryption strategies. */
+class EncryptionStrategy
+{
+public:
+    /**
+     * @brief Pure virtual text (std::string) encryption method.
+     * 
+     * @param text text to encrypt.
+     * @param key key string, empty by default.
+     * @return encrypted text.
+     */
+    virtual std::string encrypt(const std::string &text, const std::string &key = "") const = 0;
+
+    /**
+     * @brief Pure virtual text (std::string) decryption method.
+     * 
+     * @param text text to decrypt.
+     * @param key key string, empty by default.
+     * @return decrypted text.
+     */
+    virtual std::string decrypt(const std::string &text, const std::string &key = "") const = 0;
+
+    /**
+     * @brief Virtual text (std::string) re-keying method: decrypt with the old key and
+     * encrypt with the new one. Strategies override it with a single-pass shortcut.
+     * 
+     * @param text text encrypted with oldKey.
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     * @return text encrypted with newKey.
+     */
+    virtual std::string rekey(const std::string &text, const std::string &oldKey, const std::string &newKey) const
+    {
+        return encrypt(decrypt(text, oldKey), newKey);
+    }
+
+    /**
+     * @brief Virtual conversion of derived key material (see kdf::deriveKey) into a key
+     * this strategy accepts.
+     * 
+     * @param secret random bytes.
+     * @return key string; the bytes themselves by default.
+     */
+    virtual std::string keyFromSecret(const std::string &secret) const
+    {
+        return secret;
+    }
+
+    /**
+     * @brief Virtual output size, known before transforming, so outputs can be preallocated.
+     * 
+     * @param size input size in bytes.
+     * @param decrypting size of the decryption rather than of the encryption.
+     * @return output size in bytes, or -1 if it depends on the text (the default).
+     */
+    virtual long long outputSize(size_t size, bool decrypting) const
+    {
+        (void)size;
+        (void)decrypting;
+        return -1;
+    }
+
+    /**
+     * @brief Virtual block size of a block-wise strategy, whose whole blocks transform
+     * independently (see transformBlocks), so a stream is transformed piece by piece.
+     * 
+     * @param decrypting block of the decryption rather than of the encryption.
+     * @return input block size in bytes, or 0 if the text must be transformed whole (the default).
+     */
+    virtual size_t blockSize(bool decrypting) const
+    {
+        (void)decrypting;
+        return 0;
+    }
+
+    /**
+     * @brief Virtual transform of whole blocks, for strategies with a blockSize.
+     * 
+     * @param in input bytes.
+     * @param size number of input bytes, a multiple of blockSize(decrypting).
+     * @param out buffer of outputSize(size, decrypting) bytes.
+     * @param key key string.
+     * @param decrypting decrypt rather than encrypt.
+     */
+    virtual void transformBlocks(const char *in, size_t size, char *out, const std::string &key, bool decrypting) const
+    {
+        (void)in;
+        (void)size;
+        (void)out;
+        (void)key;
+        (void)decrypting;
+        throw std::logic_error("strategy is not block-wise");
+    }
+
+    virtual ~EncryptionStrategy() = default;
+};
+
+/**
+ * @brief Shared, immutable strategy object. Strategies hold no mutable state, so one
+ * handle can be used by any number of threads and jobs at once.
+ */
+using StrategyHandle = std::shared_ptr<const EncryptionStrategy>;
+
+/**
+ * @brief A basic virtual class for strategies that map every input byte to exactly one output byte.
+ * Inherted from the base virtual class EncryptionStrategy.
+ *
+ * Such strategies work on independent chunks: the stream offset of a chunk is all that is
+ * needed to select its key phase, so text is split across hardware threads.
+ */
+class LengthPreservingEncryptionStrategy : public EncryptionStrategy
+{
+public:
+    /**
+     * @brief Pure virtual chunk encryption method.
+     * 
+     * @param in bytes to encrypt.
+     * @param out buffer for the encrypted bytes, the same size as in (may alias in).
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    virtual void encryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const = 0;
+
+    /**
+     * @brief Pure virtual chunk decryption method.
+     * 
+     * @param in bytes to decrypt.
+     * @param out buffer for the decrypted bytes, the same size as in (may alias in).
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    virtual void decryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const = 0;
+
+    /**
+     * @brief Virtual per-job state, such as a plugin's context: prepared once by Job and
+     * shared by all chunks of the job, on any thread.
+     * 
+     * @param key key string.
+     * @param decrypting prepare a decryption job.
+     * @return state, or nullptr if the strategy needs none (the default).
+     */
+    virtual std::shared_ptr<void> prepareJob(const std::string &key, bool decrypting) const
+    {
+        (void)key;
+        (void)decrypting;
+        return nullptr;
+    }
+
+    /**
+     * @brief Virtual chunk transform within a job. By default the state is unused and the
+     * chunk goes to encryptChunk or decryptChunk.
+     * 
+     * @param state state from prepareJob, or nullptr outside a job.
+     * @param in input bytes.
+     * @param out buffer for the output bytes, the same size as in (may alias in).
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     * @param decrypting decrypt instead of encrypt.
+     */
+    virtual void transformChunk(void *state, const char *in, char *out, size_t size, size_t offset, const std::string &key, bool decrypting) const
+    {
+        (void)state;
+        if (decrypting)
+            decryptChunk(in, out, size, offset, key);
+        else
+            encryptChunk(in, out, size, offset, key);
+    }
+
+    /**
+     * @brief One encryption, decryption or re-keying job: the key and direction, plus the state
+     * the strategy prepares once per job. The code running a job over parallel::forChunks
+     * creates it before the loop and calls it for every chunk. The keys must outlive the job.
+     */
+    class Job
+    {
+    public:
+        /**
+         * @brief Encryption or decryption job.
+         * 
+         * @param strategy length-preserving strategy.
+         * @param key key string.
+         * @param decrypting decrypt instead of encrypt.
+         */
+        Job(const LengthPreservingEncryptionStrategy &strategy, const std::string &key, bool decrypting)
+            : strategy{strategy}, key{key}, decrypting{decrypting}, state{strategy.prepareJob(key, decrypting)} {}
+
+        /**
+         * @brief Re-keying job.
+         * 
+         * @param strategy length-preserving strategy.
+         * @param oldKey current key string.
+         * @param newKey new key string.
+         */
+        Job(const LengthPreservingEncryptionStrategy &strategy, const std::string &oldKey, const std::string &newKey)
+            : strategy{strategy}, key{oldKey}, newKey{&newKey}, decrypting{true}, state{strategy.prepareJob(oldKey, true)},
+              newState{strategy.prepareJob(newKey, false)} {}
+
+        /**
+         * @brief Transform one chunk of the job; callable from any worker thread.
+         * 
+         * @param in input bytes.
+         * @param out buffer for the output bytes, the same size as in (may alias in).
+         * @param size number of bytes.
+         * @param offset position of in within the whole text.
+         */
+        void operator()(const char *in, char *out, size_t size, size_t offset) const
+        {
+            if (!newKey)
+            {
+                strategy.transformChunk(state.get(), in, out, size, offset, key, decrypting);
+            }
+            else if (!state && !newState)
+            {
+                strategy.rekeyChunk(in, out, size, offset, key, *newKey);
+            }
+            else
+            {
+                strategy.transformChunk(state.get(), in, out, size, offset, key, true);
+                strategy.transformChunk(newState.get(), out, out, size, offset, *newKey, false);
+            }
+        }
+
+    private:
+        const LengthPreservingEncryptionStrategy &strategy;
+        const std::string &key;
+        const std::string *newKey = nullptr;
+        bool decrypting;
+        std::shared_ptr<void> state;
+        std::shared_ptr<void> newState;
+    };
+
+    /**
+     * @brief Text (std::string) encryption method, chunk-parallel.
+     * 
+     * @param text text to encrypt.
+     * @param key key string.
+     * @return encrypted text.
+     */
+    std::string encrypt(const std::string &text, const std::string &key) const override
+    {
+        std::string output(text.size(), '\0');
+        const bool streaming = kernels::wantsStreamingStores(output.size());
+        const Job job(*this, key, false);
+        parallel::forChunks(text.size(), [&](size_t begin, size_t end)
+                            {
+                                kernels::StreamingStoreScope scope(streaming);
+                                job(text.data() + begin, output.data() + begin, end - begin, begin);
+                            });
+        return output;
+    }
+
+    /**
+     * @brief Text (std::string) decryption method, chunk-parallel.
+     * 
+     * @param text text to decrypt.
+     * @param key key string.
+     * @return decrypted text.
+     */
+    std::string decrypt(const std::string &text, const std::string &key) const override
+    {
+        std::string output(text.size(), '\0');
+        const bool streaming = kernels::wantsStreamingStores(output.size());
+        const Job job(*this, key, true);
+        parallel::forChunks(text.size(), [&](size_t begin, size_t end)
+                            {
+                                kernels::StreamingStoreScope scope(streaming);
+                                job(text.data() + begin, output.data() + begin, end - begin, begin);
+                            });
+        return output;
+    }
+
+    /**
+     * @brief Virtual key period: the encryption of byte i depends only on the byte and
+     * i % period, so text can be found in ciphertext by encrypting it at each phase.
+     * 
+     * @param key key string.
+     * @return period, or 0 if the strategy has no such period (the default).
+     */
+    virtual size_t keyPeriod(const std::string &key) const
+    {
+        (void)key;
+        return 0;
+    }
+
+    /**
+     * @brief Output size of a length-preserving strategy.
+     * 
+     * @param size input size in bytes.
+     * @return size, in both directions.
+     */
+    long long outputSize(size_t size, bool) const override
+    {
+        return static_cast<long long>(size);
+    }
+
+    /**
+     * @brief Virtual identity check: with this key the output equals the input, so a job
+     * can be served as a plain copy by the kernel.
+     * 
+     * @param key key string.
+     * @return true if the key is known to leave the text unchanged (false by default).
+     */
+    virtual bool isIdentity(const std::string &key) const
+    {
+        (void)key;
+        return false;
+    }
+
+    /**
+     * @brief Virtual identity check of re-keying: decrypting with oldKey and encrypting
+     * with newKey cancel out.
+     * 
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     * @return true if re-keying is known to leave the text unchanged; by default when the
+     * keys are equal or both are identities.
+     */
+    virtual bool isIdentityRekey(const std::string &oldKey, const std::string &newKey) const
+    {
+        return oldKey == newKey || (isIdentity(oldKey) && isIdentity(newKey));
+    }
+
+    /**
+     * @brief Virtual chunk re-keying method. By default the chunk is decrypted and
+     * re-encrypted in the output buffer while it is hot in cache, so the plaintext
+     * only ever exists one chunk at a time.
+     * 
+     * @param in bytes encrypted with oldKey.
+     * @param out buffer for the bytes encrypted with newKey (may alias in).
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     */
+    virtual void rekeyChunk(const char *in, char *out, size_t size, size_t offset, const std::string &oldKey, const std::string &newKey) const
+    {
+        decryptChunk(in, out, size, offset, oldKey);
+        encryptChunk(out, out, size, offset, newKey);
+    }
+
+    /**
+     * @brief Text (std::string) re-keying method, chunk-parallel.
+     * 
+     * @param text text encrypted with oldKey.
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     * @return text encrypted with newKey.
+     */
+    std::string rekey(const std::string &text, const std::string &oldKey, const std::string &newKey) const override
+    {
+        std::string output(text.size(), '\0');
+        const bool streaming = kernels::wantsStreamingStores(output.size());
+        const Job job(*this, oldKey, newKey);
+        parallel::forChunks(text.size(), [&](size_t begin, size_t end)
+                            {
+                                kernels::StreamingStoreScope scope(streaming);
+                                job(text.data() + begin, output.data() + begin, end - begin, begin);
+                            });
+
+        return output;
+    }
+};
+
+/** @brief Concrete encryption strategy using XOR. 
+ * Inherted from the base virtual class LengthPreservingEncryptionStrategy. */
+class XOREncryptionStrategy : public LengthPreservingEncryptionStrategy
+{
+public:
+    /**
+     * @brief Chunk encryption method using XOR.
+     * 
+     * @param in bytes to encrypt.
+     * @param out buffer for the encrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    void encryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        if (key.size() >= kernels::LongKeySize)
+        {
+            return kernels::xorLongKey(key.data(), key.size(), in, out, size, offset);
+        }
+
+        kernels::applyPattern<kernels::PatternOp::Xor>(kernels::RepeatingPattern(key), in, out, size, offset);
+    }
+
+    /**
+     * @brief Chunk decryption method using XOR.
+     * 
+     * @param in bytes to decrypt.
+     * @param out buffer for the decrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    void decryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        encryptChunk(in, out, size, offset, key);
+    }
+
+    /**
+     * @brief Chunk re-keying method using XOR: one pass with the combined key
+     * old[i % old.size()] ^ new[i % new.size()], whose period is LCM(old.size(), new.size()).
+     * 
+     * @param in bytes encrypted with oldKey.
+     * @param out buffer for the bytes encrypted with newKey.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     */
+    void rekeyChunk(const char *in, char *out, size_t size, size_t offset, const std::string &oldKey, const std::string &newKey) const override
+    {
+        if (oldKey.empty() || newKey.empty())
+        {
+            return encryptChunk(in, out, size, offset, oldKey.empty() ? newKey : oldKey);
+        }
+
+        const size_t period = oldKey.size() / std::gcd(oldKey.size(), newKey.size()) * newKey.size();
+        if (period > MaxCombinedKeySize)
+        {
+            return LengthPreservingEncryptionStrategy::rekeyChunk(in, out, size, offset, oldKey, newKey);
+        }
+
+        std::string combined(period, '\0');
+        for (size_t i = 0, o = 0, n = 0; i < period; i++)
+        {
+            combined[i] = char(oldKey[o] ^ newKey[n]);
+            o = o + 1 == oldKey.size() ? 0 : o + 1;
+            n = n + 1 == newKey.size() ? 0 : n + 1;
+        }
+        encryptChunk(in, out, size, offset, combined);
+    }
+
+    /**
+     * @brief Key period of XOR.
+     * 
+     * @param key key string.
+     * @return key length (1 for the empty key).
+     */
+    size_t keyPeriod(const std::string &key) const override
+    {
+        return std::max<size_t>(1, key.size());
+    }
+
+    /**
+     * @brief Identity check of XOR.
+     * 
+     * @param key key string.
+     * @return true for an empty or all-zero key.
+     */
+    bool isIdentity(const std::string &key) const override
+    {
+        return std::all_of(key.begin(), key.end(), [](char c) { return c == 0; });
+    }
+
+    /**
+     * @brief Identity check of XOR re-keying.
+     * 
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     * @return true if the combined key old ^ new is all zero.
+     */
+    bool isIdentityRekey(const std::string &oldKey, const std::string &newKey) const override
+    {
+        return kernels::samePattern(oldKey, newKey, MaxCombinedKeySize);
+    }
+
+private:
+    /** @brief Longest combined re-keying key; beyond it the two keys are applied one after the other. */
+    static constexpr size_t MaxCombinedKeySize = size_t(1) << 16;
+};
+
+/**
+ * @brief Concrete encryption strategy using Caesar. 
+ * Inherted from the base virtual class LengthPreservingEncryptionStrategy.
+ */
+class CaesarEncryptionStrategy : public LengthPreservingEncryptionStrategy
+{
+    const size_t ASCIISize = 255;
+
+public:
+    /**
+     * @brief Chunk encryption method using Caesar.
+     * 
+     * @param in bytes to encrypt.
+     * @param out buffer for the encrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    void encryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        const std::string pattern(1, char(shiftOf(key)));
+        kernels::applyPattern<kernels::PatternOp::Add>(kernels::RepeatingPattern(pattern), in, out, size, offset);
+    }
+
+    /**
+     * @brief Chunk decryption method using Caesar.
+     * 
+     * @param in bytes to decrypt.
+     * @param out buffer for the decrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    void decryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        const std::string pattern(1, char(-char(shiftOf(key))));
+        kernels::applyPattern<kernels::PatternOp::Add>(kernels::RepeatingPattern(pattern), in, out, size, offset);
+    }
+
+    /**
+     * @brief Chunk re-keying method using Caesar: one pass with the net shift new - old.
+     * 
+     * @param in bytes encrypted with oldKey.
+     * @param out buffer for the bytes encrypted with newKey.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     */
+    void rekeyChunk(const char *in, char *out, size_t size, size_t offset, const std::string &oldKey, const std::string &newKey) const override
+    {
+        const auto shift = char(shiftOf(newKey) - shiftOf(oldKey));
+        kernels::applyPattern<kernels::PatternOp::Add>(kernels::RepeatingPattern(std::string(1, shift)), in, out, size, offset);
+    }
+
+    /**
+     * @brief Key period of Caesar.
+     * 
+     * @param key key string.
+     * @return 1, every byte is shifted alike.
+     */
+    size_t keyPeriod(const std::string &) const override
+    {
+        return 1;
+    }
+
+    /**
+     * @brief Identity check of Caesar.
+     * 
+     * @param key key string.
+     * @return true if the shift is a multiple of 255.
+     */
+    bool isIdentity(const std::string &key) const override
+    {
+        return shiftOf(key) == 0;
+    }
+
+    /**
+     * @brief Identity check of Caesar re-keying.
+     * 
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     * @return true if the net shift is a multiple of 255.
+     */
+    bool isIdentityRekey(const std::string &oldKey, const std::string &newKey) const override
+    {
+        return shiftOf(oldKey) == shiftOf(newKey);
+    }
+
+    /**
+     * @brief Caesar key from derived key material.
+     * 
+     * @param secret random bytes.
+     * @return decimal shift made of the first eight bytes.
+     */
+    std::string keyFromSecret(const std::string &secret) const override
+    {
+        std::uint64_t shift = 0;
+        std::memcpy(&shift, secret.data(), std::min(secret.size(), sizeof(shift)));
+        return std::to_string(shift);
+    }
+
+private:
+    /**
+     * @brief Parse a Caesar key with std::stoull's rules ("3abc" is 3).
+     * 
+     * @param key decimal shift.
+     * @return shift modulo 255.
+     * @throw std::invalid_argument if the key does not start with a number.
+     */
+    size_t shiftOf(const std::string &key) const
+    {
+        try
+        {
+            return std::stoull(key) % ASCIISize;
+        }
+        catch (const std::logic_error &)
+        {
+            throw std::invalid_argument("Caesar key must be a decimal shift, got \"" + key + "\"");
+        }
+    }
+};
+
+/**
+ * @brief Concrete encryption strategy using Vigenere (a Caesar shift per key position). 
+ * Inherted from the base virtual class LengthPreservingEncryptionStrategy.
+ *
+ * The key is a list of decimal shifts separated by any non-digit characters ("3,1,4").
+ * Byte i is shifted by shift[i % count] modulo 255, exactly as CaesarEncryptionStrategy does.
+ */
+class VigenereEncryptionStrategy : public LengthPreservingEncryptionStrategy
+{
+    const size_t ASCIISize = 255;
+
+public:
+    /**
+     * @brief Chunk encryption method using Vigenere.
+     * 
+     * @param in bytes to encrypt.
+     * @param out buffer for the encrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    void encryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        kernels::applyPattern<kernels::PatternOp::Add>(kernels::RepeatingPattern(makeShifts(key, false)), in, out, size, offset);
+    }
+
+    /**
+     * @brief Chunk decryption method using Vigenere.
+     * 
+     * @param in bytes to decrypt.
+     * @param out buffer for the decrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    void decryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        kernels::applyPattern<kernels::PatternOp::Add>(kernels::RepeatingPattern(makeShifts(key, true)), in, out, size, offset);
+    }
+
+    /**
+     * @brief Key period of Vigenere.
+     * 
+     * @param key key string.
+     * @return number of shifts.
+     */
+    size_t keyPeriod(const std::string &key) const override
+    {
+        return makeShifts(key, false).size();
+    }
+
+    /**
+     * @brief Identity check of Vigenere.
+     * 
+     * @param key key string.
+     * @return true if every shift is a multiple of 255.
+     */
+    bool isIdentity(const std::string &key) const override
+    {
+        const std::string shifts = makeShifts(key, false);
+        return std::all_of(shifts.begin(), shifts.end(), [](char c) { return c == 0; });
+    }
+
+    /**
+     * @brief Identity check of Vigenere re-keying.
+     * 
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     * @return true if both keys shift every position alike.
+     */
+    bool isIdentityRekey(const std::string &oldKey, const std::string &newKey) const override
+    {
+        return kernels::samePattern(makeShifts(oldKey, false), makeShifts(newKey, false));
+    }
+
+    /**
+     * @brief Vigenere key from derived key material.
+     * 
+     * @param secret random bytes.
+     * @return one decimal shift per byte, separated by commas.
+     */
+    std::string keyFromSecret(const std::string &secret) const override
+    {
+        std::string key;
+        for (const auto &ch : secret)
+        {
+            key += (key.empty() ? "" : ",") + std::to_string(std::uint8_t(ch));
+        }
+        return key;
+    }
+
+    /**
+     * @brief Parse the key into one byte shift per key position.
+     * 
+     * @param key list of decimal shifts.
+     * @param inverse negate the shifts (for decryption).
+     * @return shift pattern, one byte per position.
+     * @throw std::invalid_argument if the key holds no shift or a shift does not fit 64 bits.
+     */
+    std::string makeShifts(const std::string &key, bool inverse) const
+    {
+        std::string shifts;
+
+        for (size_t begin = key.find_first_of("0123456789"); begin != std::string::npos;)
+        {
+            const size_t end = key.find_first_not_of("0123456789", begin);
+            char shift;
+            try
+            {
+                shift = char(std::stoull(key.substr(begin, end - begin)) % ASCIISize);
+            }
+            catch (const std::out_of_range &)
+            {
+                throw std::invalid_argument("Vigenere shift out of range in key \"" + key + "\"");
+            }
+            shifts += inverse ? char(-shift) : shift;
+            begin = end == std::string::npos ? end : key.find_first_of("0123456789", end);
+        }
+
+        if (shifts.empty())
+            throw std::invalid_argument("Vigenere key must hold decimal shifts, got \"" + key + "\"");
+        return shifts;
+    }
+
+};
+
+/** @brief Concrete encryption strategy using Binary code. 
+ * Inherted from the base virtual class EncryptionStrategy. */
+class BinaryEncryptionStrategy : public EncryptionStrategy
+{
+public:
+    /**
+     * @brief Text (std::string) encryption method using Binary code.
+     * 
+     * @param text text to encrypt.
+     * @return encrypted text by Binary code.
+     */
+    std::string encrypt(const std::string &text, const std::string &) const override
+    {
+        std::string output(text.size() * 8, '\0');
+        const bool streaming = kernels::wantsStreamingStores(output.size());
+        parallel::forChunks(text.size(), [&](size_t begin, size_t end)
+                            {
+                                kernels::StreamingStoreScope scope(streaming);
+                                kernels::expandBits(text.data() + begin, output.data() + 8 * begin, end - begin);
+                            });
+        return output;
+    }
+
+    /**
+     * @brief Text (std::string) decryption method using Binary code.
+     * 
+     * @param text text to decrypt.
+     * @return decrypted text by Binary code.
+     */
+    std::string decrypt(const std::string &text, const std::string &) const override
+    {
+        std::stringstream decoded;
+
+        for (std::string::const_iterator segmentIterator{text.begin()}; segmentIterator != text.end(); segmentIterator += 8)
+        {
+            std::string segment(segmentIterator, segmentIterator + 8);
+            auto ASCII = std::stoull(segment, nullptr, 2);
+            decoded << char(ASCII);
+        }
+
+        return decoded.str();
+    }
+
+    /**
+     * @brief Output size of Binary code.
+     * 
+     * @param size input size in bytes.
+     * @param decrypting size of the decoding rather than of the encoding.
+     * @return eight characters per byte when encoding, one byte per eight characters when decoding.
+     */
+    long long outputSize(size_t size, bool decrypting) const override
+    {
+        return static_cast<long long>(decrypting ? size / 8 : size * 8);
+    }
+
+    /**
+     * @brief Block size of Binary code.
+     * 
+     * @param decrypting block of the decoding rather than of the encoding.
+     * @return one byte when encoding, eight characters when decoding.
+     */
+    size_t blockSize(bool decrypting) const override
+    {
+        return decrypting ? 8 : 1;
+    }
+
+    /**
+     * @brief Binary code of whole blocks.
+     * 
+     * @param in input bytes.
+     * @param size number of input bytes, a multiple of blockSize(decrypting).
+     * @param out buffer of outputSize(size, decrypting) bytes.
+     * @param decrypting decode rather than encode.
+     */
+    void transformBlocks(const char *in, size_t size, char *out, const std::string &, bool decrypting) const override
+    {
+        if (!decrypting)
+        {
+            kernels::expandBits(in, out, size);
+            return;
+        }
+
+        for (size_t done = 0; done < size / 8;)
+        {
+            done += kernels::packBits(in + 8 * done, out + done, size / 8 - done);
+            if (done < size / 8)
+            {
+                // A group that is not plain binary digits follows the rules of decrypt().
+                out[done] = char(std::stoull(std::string(in + 8 * done, 8), nullptr, 2));
+                done++;
+            }
+        }
+    }
+};
+
+/**
+ * @brief Concrete encryption strategy using XOR with a keystream seeded by the key. 
+ * Inherted from the base virtual class LengthPreservingEncryptionStrategy.
+ *
+ * Unlike XOREncryptionStrategy the key is never repeated: it seeds a Philox4x32-10
+ * counter-based generator, so the keystream has no short period and any chunk
+ * (and any byte range, for random-access decryption) computes its own keystream.
+ */
+class KeystreamXOREncryptionStrategy : public LengthPreservingEncryptionStrategy
+{
+public:
+    /**
+     * @brief Chunk encryption method using the keystream.
+     * 
+     * @param in bytes to encrypt.
+     * @param out buffer for the encrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string (seed).
+     */
+    void encryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        kernels::xorKeystream(kernels::Philox(key), in, out, size, offset);
+    }
+
+    /**
+     * @brief Chunk decryption method using the keystream.
+     * 
+     * @param in bytes to decrypt.
+     * @param out buffer for the decrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string (seed).
+     */
+    void decryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        encryptChunk(in, out, size, offset, key);
+    }
+};
+
+/**
+ * @brief Concrete encryption strategy using an arbitrary byte substitution (S-box).
+ * Inherted from the base virtual class LengthPreservingEncryptionStrategy.
+ *
+ * The key selects the table:
+ * - a decimal number gives the Caesar shift table (same output as CaesarEncryptionStrategy);
+ * - a 256-byte key that is a permutation of all byte values is used as the table verbatim;
+ * - any other key seeds a pseudo-random permutation.
+ */
+class SubstitutionEncryptionStrategy : public LengthPreservingEncryptionStrategy
+{
+    const size_t ASCIISize = 255;
+
+public:
+    /**
+     * @brief Chunk encryption method using byte substitution.
+     * 
+     * @param in bytes to encrypt.
+     * @param out buffer for the encrypted bytes.
+     * @param size number of bytes.
+     * @param key key string.
+     */
+    void encryptChunk(const char *in, char *out, size_t size, size_t, const std::string &key) const override
+    {
+        kernels::substitute(makeTable(key), in, out, size);
+    }
+
+    /**
+     * @brief Chunk decryption method using byte substitution.
+     * 
+     * @param in bytes to decrypt.
+     * @param out buffer for the decrypted bytes.
+     * @param size number of bytes.
+     * @param key key string.
+     */
+    void decryptChunk(const char *in, char *out, size_t size, size_t, const std::string &key) const override
+    {
+        kernels::substitute(invertTable(makeTable(key)), in, out, size);
+    }
+
+    /**
+     * @brief Chunk re-keying method using byte substitution: one lookup in the
+     * composed table new(old^-1(x)).
+     * 
+     * @param in bytes encrypted with oldKey.
+     * @param out buffer for the bytes encrypted with newKey.
+     * @param size number of bytes.
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     */
+    void rekeyChunk(const char *in, char *out, size_t size, size_t, const std::string &oldKey, const std::string &newKey) const override
+    {
+        const kernels::ByteTable inverse = invertTable(makeTable(oldKey));
+        const kernels::ByteTable forward = makeTable(newKey);
+        kernels::ByteTable composed;
+        for (size_t i = 0; i < composed.size(); i++)
+        {
+            composed[i] = forward[inverse[i]];
+        }
+        kernels::substitute(composed, in, out, size);
+    }
+
+    /**
+     * @brief Key period of byte substitution.
+     * 
+     * @param key key string.
+     * @return 1, the table does not depend on the position.
+     */
+    size_t keyPeriod(const std::string &) const override
+    {
+        return 1;
+    }
+
+    /**
+     * @brief Identity check of byte substitution.
+     * 
+     * @param key key string.
+     * @return true if the table maps every byte to itself.
+     */
+    bool isIdentity(const std::string &key) const override
+    {
+        const kernels::ByteTable table = makeTable(key);
+        for (size_t i = 0; i < table.size(); i++)
+        {
+            if (table[i] != i)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Identity check of byte substitution re-keying.
+     * 
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     * @return true if both keys give the same table.
+     */
+    bool isIdentityRekey(const std::string &oldKey, const std::string &newKey) const override
+    {
+        return makeTable(oldKey) == makeTable(newKey);
+    }
+
+    /**
+     * @brief Build the substitution table (S-box) for the key.
+     * 
+     * @param key key string.
+     * @return table mapping plain bytes to encrypted bytes.
+     */
+    kernels::ByteTable makeTable(const std::string &key) const
+    {
+        kernels::ByteTable table;
+
+        if (!key.empty() && key.find_first_not_of("0123456789") == std::string::npos)
+        {
+            auto shift = std::uint8_t(std::stoull(key) % ASCIISize);
+            for (size_t i = 0; i < table.size(); i++)
+            {
+                table[i] = std::uint8_t(i + shift);
+            }
+            return table;
+        }
+
+        if (key.size() == table.size())
+        {
+            std::copy(key.begin(), key.end(), table.begin());
+            if (isPermutation(table))
+            {
+                return table;
+            }
+        }
+
+        for (size_t i = 0; i < table.size(); i++)
+        {
+            table[i] = std::uint8_t(i);
+        }
+
+        if (key.empty())
+        {
+            return table;
+        }
+
+        // The key hash seeds a splitmix64 generator driving a Fisher-Yates shuffle.
+        std::uint64_t state = kernels::hashKey(key);
+        for (size_t i = table.size() - 1; i > 0; i--)
+        {
+            std::swap(table[i], table[kernels::splitmix64(state) % (i + 1)]);
+        }
+
+        return table;
+    }
+
+    /**
+     * @brief Build the inverse of a substitution table.
+     * 
+     * @param table permutation table.
+     * @return table mapping encrypted bytes back to plain bytes.
+     */
+    static kernels::ByteTable invertTable(const kernels::ByteTable &table)
+    {
+        kernels::ByteTable inverse{};
+        for (size_t i = 0; i < table.size(); i++)
+        {
+            inverse[table[i]] = std::uint8_t(i);
+        }
+        return inverse;
+    }
+
+private:
+    /** @brief Check that every byte value occurs exactly once in the table. */
+    static bool isPermutation(const kernels::ByteTable &table)
+    {
+        std::array<bool, 256> seen{};
+        for (const auto &value : table)
+        {
+            if (seen[value])
+            {
+                return false;
+            }
+            seen[value] = true;
+        }
+        return true;
+    }
+};
+
+/** @brief Positional file I/O shared by the chunked file pipelines. */
+namespace fileio
+{
+    /** @brief Size of one I/O chunk read or written at a time by a worker. */
+    constexpr size_t ChunkSize = size_t(1) << 20;
+
+    /** @brief Owning POSIX file descriptor. */
+    class Descriptor
+    {
+    public:
+        /**
+         * @brief Open a file.
+         * 
+         * @param path path to the file.
+         * @param flags open(2) flags.
+         */
+        Descriptor(const std::string &path, int flags) : fd{::open(path.c_str(), flags | O_CLOEXEC, 0666)} {}
+
+        Descriptor(const Descriptor &) = delete;
+        Descriptor &operator=(const Descriptor &) = delete;
+
+        ~Descriptor()
+        {
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+        }
+
+        /** @return true if the file was opened. */
+        explicit operator bool() const { return fd >= 0; }
+
+        /** @return raw descriptor. */
+        int get() const { return fd; }
+
+        /** @return file size in bytes, or -1 on error. */
+        off_t size() const
+        {
+            struct stat st;
+            return ::fstat(fd, &st) == 0 ? st.st_size : -1;
+        }
+
+    private:
+        int fd;
+    };
+
+    /** @brief Read-only memory mapping of a whole file. */
+    class MappedFile
+    {
+    public:
+        /**
+         * @brief Map a file.
+         * 
+         * @param path path to the file.
+         */
+        explicit MappedFile(const std::string &path)
+        {
+            Descriptor file(path, O_RDONLY);
+            const off_t fileSize = file ? file.size() : -1;
+            if (fileSize < 0)
+                return;
+
+            mapped = true;
+            size = size_t(fileSize);
+            if (size)
+            {
+                void *address = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.get(), 0);
+                if (address == MAP_FAILED)
+                {
+                    mapped = false;
+                    size = 0;
+                    return;
+                }
+                ::madvise(address, size, MADV_SEQUENTIAL);
+                bytes = static_cast<const char *>(address);
+            }
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        ~MappedFile()
+        {
+            if (bytes)
+            {
+                ::munmap(const_cast<char *>(bytes), size);
+            }
+        }
+
+        /** @return true if the file was opened and mapped. */
+        explicit operator bool() const { return mapped; }
+
+        /** @return mapped bytes (nullptr for an empty file). */
+        const char *data() const { return bytes; }
+
+        /** @return file size in bytes. */
+        size_t length() const { return size; }
+
+    private:
+        const char *bytes = nullptr;
+        size_t size = 0;
+        bool mapped = false;
+    };
+
+    /**
+     * @brief Read exactly size bytes at offset, retrying short reads.
+     * 
+     * @return true if all bytes were read.
+     */
+    inline bool readAt(int fd, char *buffer, size_t size, size_t offset)
+    {
+        while (size)
+        {
+            const ssize_t done = ::pread(fd, buffer, size, off_t(offset));
+            if (done <= 0)
+            {
+                return false;
+            }
+            buffer += done;
+            offset += size_t(done);
+            size -= size_t(done);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Write exactly size bytes at offset, retrying short writes.
+     * 
+     * @return true if all bytes were written.
+     */
+    inline bool writeAt(int fd, const char *buffer, size_t size, size_t offset)
+    {
+        while (size)
+        {
+            const ssize_t done = ::pwrite(fd, buffer, size, off_t(offset));
+            if (done <= 0)
+            {
+                return false;
+            }
+            buffer += done;
+            offset += size_t(done);
+            size -= size_t(done);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Write a whole buffer to a stream descriptor (pipe, socket), retrying short writes.
+     * 
+     * @return true if all bytes were written.
+     */
+    inline bool writeAll(int fd, const char *buffer, size_t size)
+    {
+        while (size)
+        {
+            const ssize_t done = ::write(fd, buffer, size);
+            if (done <= 0)
+            {
+                return false;
+            }
+            buffer += done;
+            size -= size_t(done);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Read a stream descriptor (pipe, socket) until end of file.
+     * 
+     * @return bytes read.
+     */
+    inline std::string readAll(int fd)
+    {
+        std::string data;
+        char buffer[4096];
+        ssize_t done;
+        while ((done = ::read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            data.append(buffer, size_t(done));
+        }
+        return data;
+    }
+
+    /**
+     * @brief Transform the byte range [begin, end) of a file into the same range of another,
+     * one ChunkSize buffer at a time. The buffer is reused and read straight back by write(),
+     * so it is transformed with regular stores whatever the store mode.
+     * 
+     * @param inFd input descriptor.
+     * @param outFd output descriptor.
+     * @param begin first byte offset.
+     * @param end byte offset past the range.
+     * @param fn callable taking (buffer, size, offset) and transforming the buffer in place.
+     * @return true if every chunk was read, transformed and written.
+     */
+    template <typename Fn>
+    bool transformRange(int inFd, int outFd, size_t begin, size_t end, Fn &&fn)
+    {
+        std::vector<char> buffer(std::min(ChunkSize, end - begin));
+
+        for (size_t offset = begin; offset < end; offset += buffer.size())
+        {
+            const size_t size = std::min(buffer.size(), end - offset);
+            bool done;
+            {
+                trace::Span span("read", size);
+                SFE_PROBE(io__submit, inFd, offset, size, 0);
+                done = readAt(inFd, buffer.data(), size, offset);
+                SFE_PROBE(io__complete, inFd, offset, size, 0, done);
+            }
+            if (done)
+            {
+                trace::Span span("transform", size);
+                SFE_PROBE(chunk__dispatch, offset, size);
+                done = fn(buffer.data(), size, offset);
+                SFE_PROBE(chunk__complete, offset, size, done);
+            }
+            if (done)
+            {
+                trace::Span span("write", size);
+                SFE_PROBE(io__submit, outFd, offset, size, 1);
+                done = writeAt(outFd, buffer.data(), size, offset);
+                SFE_PROBE(io__complete, outFd, offset, size, 1, done);
+            }
+            if (!done)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reserve the blocks of an output before writing it, so the filesystem can lay it
+     * out contiguously instead of allocating extents (and updating metadata) chunk by chunk.
+     * Filesystems without fallocate support are left to allocate on write.
+     * 
+     * @param fd output descriptor.
+     * @param size final size in bytes.
+     */
+    inline void preallocate(int fd, size_t size)
+    {
+#ifdef __linux__
+        if (size)
+        {
+            ::fallocate(fd, 0, 0, off_t(size));
+        }
+#else
+        (void)fd;
+        (void)size;
+#endif
+    }
+
+    /** @brief Where a file starts on its device, for ordering reads on rotating disks. */
+    struct PhysicalLocation
+    {
+        /** @brief Device of the file. */
+        std::uint64_t device = 0;
+        /** @brief Physical byte offset of the first extent; max if unknown (no extents, no FIEMAP). */
+        std::uint64_t offset = std::numeric_limits<std::uint64_t>::max();
+
+        bool operator<(const PhysicalLocation &other) const
+        {
+            return device != other.device ? device < other.device : offset < other.offset;
+        }
+    };
+
+    /**
+     * @brief Locate the first extent of a file with FIEMAP.
+     * 
+     * @param path path to the file.
+     * @return device and physical offset; the offset is unknown if the file cannot be
+     * opened, is empty, or the filesystem does not map extents.
+     */
+    inline PhysicalLocation locate(const std::string &path)
+    {
+        PhysicalLocation location;
+        Descriptor file(path, O_RDONLY);
+        struct stat info;
+        if (!file || ::fstat(file.get(), &info) != 0)
+            return location;
+        location.device = std::uint64_t(info.st_dev);
+
+#ifdef __linux__
+        alignas(fiemap) char request[sizeof(fiemap) + sizeof(fiemap_extent)] = {};
+        auto *map = reinterpret_cast<fiemap *>(request);
+        map->fm_start = 0;
+        map->fm_length = FIEMAP_MAX_OFFSET;
+        map->fm_extent_count = 1;
+        // Data still in delayed allocation has no block yet.
+        if (::ioctl(file.get(), FS_IOC_FIEMAP, map) == 0 && map->fm_mapped_extents > 0 &&
+            !(map->fm_extents[0].fe_flags & FIEMAP_EXTENT_UNKNOWN))
+        {
+            location.offset = map->fm_extents[0].fe_physical;
+        }
+#endif
+        return location;
+    }
+
+    /**
+     * @brief Order files by where they start on disk, so a batch reads a rotating disk in one
+     * sweep instead of seeking back and forth in directory order.
+     * 
+     * @param paths paths to the files.
+     * @return indices into paths, by device and physical offset; files that cannot be located
+     * keep their relative order at the end of their device.
+     */
+    inline std::vector<size_t> physicalOrder(const std::vector<std::string> &paths)
+    {
+        std::vector<PhysicalLocation> locations;
+        for (const auto &path : paths)
+        {
+            locations.push_back(locate(path));
+        }
+
+        std::vector<size_t> order(paths.size());
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return locations[a] < locations[b]; });
+        return order;
+    }
+
+    /**
+     * @brief Copy a whole file inside the kernel, for jobs whose transform is the identity:
+     * a reflink (FICLONE) where the filesystem shares extents, otherwise copy_file_range
+     * between regular files, otherwise sendfile (also to pipes, sockets and devices), and
+     * read/write as the last resort.
+     * 
+     * @param filePathFrom input path.
+     * @param filePathTo output path, truncated.
+     * @return true on success, false if a file could not be opened, read or written.
+     */
+    inline bool copyFile(const std::string &filePathFrom, const std::string &filePathTo)
+    {
+        Descriptor input(filePathFrom, O_RDONLY);
+        if (!input)
+            return false;
+
+        const off_t size = input.size();
+        Descriptor output(filePathTo, O_WRONLY | O_CREAT | O_TRUNC);
+        if (!output || size < 0)
+            return false;
+
+        struct stat info;
+        const bool regular = ::fstat(output.get(), &info) == 0 && S_ISREG(info.st_mode);
+        size_t offset = 0;
+
+#ifdef __linux__
+        if (regular && ::ioctl(output.get(), FICLONE, input.get()) == 0)
+            return true;
+
+        while (regular && offset < size_t(size))
+        {
+            const ssize_t done = ::copy_file_range(input.get(), nullptr, output.get(), nullptr, size_t(size) - offset, 0);
+            if (done < 0 && errno == EINTR)
+                continue;
+            if (done <= 0)
+                break;
+            offset += size_t(done);
+        }
+
+        while (offset < size_t(size))
+        {
+            off_t position = off_t(offset);
+            const ssize_t done = ::sendfile(output.get(), input.get(), &position, size_t(size) - offset);
+            if (done < 0 && errno == EINTR)
+                continue;
+            if (done <= 0)
+                break;
+            offset += size_t(done);
+        }
+#else
+        (void)regular;
+#endif
+
+        std::vector<char> buffer(std::min(ChunkSize, size_t(size) - offset));
+        for (; offset < size_t(size); offset += buffer.size())
+        {
+            const size_t length = std::min(buffer.size(), size_t(size) - offset);
+            if (!readAt(input.get(), buffer.data(), length, offset) || !writeAll(output.get(), buffer.data(), length))
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Transform a whole file into another of the same size, in parallel ranges.
+     * Neither file is loaded into memory; each worker holds one chunk buffer.
+     * 
+     * @param filePathFrom input path.
+     * @param filePathTo output path, truncated to the input size.
+     * @param fn callable taking (buffer, size, offset) and transforming the buffer in place;
+     * returns false to abort.
+     * @return true on success, false if a file could not be opened, read or written.
+     */
+    template <typename Fn>
+    bool transformFile(const std::string &filePathFrom, const std::string &filePathTo, Fn &&fn)
+    {
+        Descriptor input(filePathFrom, O_RDONLY);
+        if (!input)
+            return false;
+
+        const off_t size = input.size();
+        Descriptor output(filePathTo, O_WRONLY | O_CREAT | O_TRUNC);
+        if (!output || size < 0)
+            return false;
+        preallocate(output.get(), size_t(size));
+        if (::ftruncate(output.get(), size) != 0)
+            return false;
+
+        std::atomic<bool> ok{true};
+        parallel::forChunks(size_t(size), [&](size_t begin, size_t end)
+                            {
+                                if (!transformRange(input.get(), output.get(), begin, end, fn))
+                                {
+                                    ok = false;
+                                }
+                            });
+        return ok;
+    }
+}
+
+/** @brief Plugin context for one key and direction, destroyed with the plugin's destroy(). */
+class PluginContext
+{
+public:
+    /**
+     * @brief Create the context.
+     * 
+     * @param plugin plugin descriptor.
+     * @param key key string.
+     * @param direction SFE_ENCRYPT or SFE_DECRYPT.
+     */
+    PluginContext(const sfe_strategy_plugin &plugin, const std::string &key, int direction)
+        : plugin{plugin}, context{plugin.create(reinterpret_cast<const unsigned char *>(key.data()), key.size(), direction)}
+    {
+        if (!context)
+        {
+            throw std::invalid_argument(std::string("plugin ") + plugin.name + " rejected the key");
+        }
+    }
+
+    PluginContext(const PluginContext &) = delete;
+    PluginContext &operator=(const PluginContext &) = delete;
+
+    ~PluginContext() { plugin.destroy(context); }
+
+    /** @return raw context passed to the plugin functions. */
+    void *get() const { return context; }
+
+private:
+    const sfe_strategy_plugin &plugin;
+    void *context;
+};
+
+/**
+ * @brief Adapter of a length-preserving, seekable plugin.
+ * Inherted from the base virtual class LengthPreservingEncryptionStrategy, so the plugin
+ * runs in the same chunked, parallel and sharded pipelines as the built-in strategies.
+ */
+class PluginChunkedEncryptionStrategy : public LengthPreservingEncryptionStrategy
+{
+public:
+    /**
+     * @brief Construct the adapter.
+     * 
+     * @param plugin descriptor with SFE_CAP_LENGTH_PRESERVING and SFE_CAP_SEEKABLE.
+     */
+    explicit PluginChunkedEncryptionStrategy(const sfe_strategy_plugin &plugin) : plugin{plugin} {}
+
+    /**
+     * @brief Chunk encryption method calling the plugin.
+     * 
+     * @param in bytes to encrypt.
+     * @param out buffer for the encrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    void encryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        transformChunk(nullptr, in, out, size, offset, key, false);
+    }
+
+    /**
+     * @brief Chunk decryption method calling the plugin.
+     * 
+     * @param in bytes to decrypt.
+     * @param out buffer for the decrypted bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     */
+    void decryptChunk(const char *in, char *out, size_t size, size_t offset, const std::string &key) const override
+    {
+        transformChunk(nullptr, in, out, size, offset, key, true);
+    }
+
+    /**
+     * @brief Plugin context of a job, shared by all its chunks and threads (seekable
+     * contexts are thread-safe).
+     * 
+     * @param key key string.
+     * @param decrypting prepare a decryption job.
+     * @return PluginContext.
+     */
+    std::shared_ptr<void> prepareJob(const std::string &key, bool decrypting) const override
+    {
+        return std::make_shared<PluginContext>(plugin, key, decrypting ? SFE_DECRYPT : SFE_ENCRYPT);
+    }
+
+    /**
+     * @brief Chunk transform calling the plugin with the job's context; outside a job a
+     * context is created for the single call.
+     * 
+     * @param state PluginContext from prepareJob, or nullptr.
+     * @param in input bytes.
+     * @param out buffer for the output bytes.
+     * @param size number of bytes.
+     * @param offset position of in within the whole text.
+     * @param key key string.
+     * @param decrypting decrypt instead of encrypt.
+     */
+    void transformChunk(void *state, const char *in, char *out, size_t size, size_t offset, const std::string &key, bool decrypting) const override
+    {
+        std::unique_ptr<PluginContext> single;
+        if (!state)
+        {
+            single = std::make_unique<PluginContext>(plugin, key, decrypting ? SFE_DECRYPT : SFE_ENCRYPT);
+        }
+        const PluginContext &context = state ? *static_cast<PluginContext *>(state) : *single;
+        if (plugin.transform(context.get(), reinterpret_cast<const unsigned char *>(in), reinterpret_cast<unsigned char *>(out), size, offset) != 0)
+        {
+            // Reaches the job's calling thread through parallel::forChunks.
+            throw std::runtime_error(std::string("plugin ") + plugin.name + " failed");
+        }
+    }
+
+private:
+    const sfe_strategy_plugin &plugin;
+};
+
+
+/**
+ * @brief Adapter of a plugin that must be driven sequentially from the first byte
+ * (not length-preserving, or length-preserving but not seekable).
+ * Inherted from the base virtual class EncryptionStrategy.
+ */
+class PluginStreamEncryptionStrategy : public EncryptionStrategy
+{
+public:
+    /**
+     * @brief Construct the adapter.
+     * 
+     * @param plugin plugin descriptor.
+     */
+    explicit PluginStreamEncryptionStrategy(const sfe_strategy_plugin &plugin) : plugin{plugin} {}
+
+    /**
+     * @brief Text (std::string) encryption method calling the plugin.
+     * 
+     * @param text text to encrypt.
+     * @param key key string.
+     * @return encrypted text.
+     */
+    std::string encrypt(const std::string &text, const std::string &key) const override
+    {
+        return transform(text, key, SFE_ENCRYPT);
+    }
+
+    /**
+     * @brief Text (std::string) decryption method calling the plugin.
+     * 
+     * @param text text to decrypt.
+     * @param key key string.
+     * @return decrypted text.
+     */
+    std::string decrypt(const std::string &text, const std::string &key) const override
+    {
+        return transform(text, key, SFE_DECRYPT);
+    }
+
+private:
+    const sfe_strategy_plugin &plugin;
+
+    std::string transform(const std::string &text, const std::string &key, int direction) const
+    {
+        PluginContext context(plugin, key, direction);
+        const auto in = reinterpret_cast<const unsigned char *>(text.data());
+
+        if (plugin.capabilities & SFE_CAP_LENGTH_PRESERVING)
+        {
+            std::string output(text.size(), '\0');
+            for (size_t offset = 0; offset < text.size(); offset += fileio::ChunkSize)
+            {
+                const size_t size = std::min(fileio::ChunkSize, text.size() - offset);
+                check(plugin.transform(context.get(), in + offset, reinterpret_cast<unsigned char *>(&output[offset]), size, offset));
+            }
+            return output;
+        }
+
+        std::string output;
+        for (size_t offset = 0;; offset += fileio::ChunkSize)
+        {
+            const size_t size = std::min(fileio::ChunkSize, text.size() - offset);
+            const bool final = offset + size == text.size();
+            const size_t used = output.size();
+            size_t produced = 0;
+
+            output.resize(used + plugin.max_output(context.get(), size));
+            check(plugin.transform_stream(context.get(), in + offset, size, final,
+                                          reinterpret_cast<unsigned char *>(&output[used]), output.size() - used, &produced));
+            output.resize(used + produced);
+
+            if (final)
+            {
+                return output;
+            }
+        }
+    }
+
+    void check(int status) const
+    {
+        if (status != 0)
+        {
+            throw std::runtime_error(std::string("plugin ") + plugin.name + " failed");
+        }
+    }
+};
+
+/**
+ * @brief Strategies loaded from plugins with dlopen.
+ *
+ * Plugins are loaded once (typically at startup, before any job runs) and stay loaded
+ * until the process exits, so their descriptors and adapters never dangle.
+ */
+class StrategyPlugins
+{
+public:
+    /**
+     * @brief Load a plugin and register its strategy under the plugin's name.
+     * 
+     * @param path path to the shared library.
+     * @return true if the plugin was loaded and its ABI version and functions are usable.
+     */
+    static bool load(const std::string &path)
+    {
+        void *library = ::dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!library)
+            return false;
+
+        const auto entry = reinterpret_cast<sfe_strategy_plugin_entry_fn>(::dlsym(library, SFE_PLUGIN_ENTRY_SYMBOL));
+        const sfe_strategy_plugin *plugin = entry ? entry(SFE_PLUGIN_ABI_VERSION) : nullptr;
+        if (!plugin || (plugin->abi_version >> 16) != (SFE_PLUGIN_ABI_VERSION >> 16) || !plugin->name ||
+            !plugin->create || !plugin->destroy ||
+            ((plugin->capabilities & SFE_CAP_LENGTH_PRESERVING) ? !plugin->transform : (!plugin->transform_stream || !plugin->max_output)))
+        {
+            ::dlclose(library);
+            return false;
+        }
+
+        const bool chunked = (plugin->capabilities & SFE_CAP_LENGTH_PRESERVING) && (plugin->capabilities & SFE_CAP_SEEKABLE);
+        StrategyHandle strategy;
+        if (chunked)
+            strategy = std::make_shared<const PluginChunkedEncryptionStrategy>(*plugin);
+        else
+            strategy = std::make_shared<const PluginStreamEncryptionStrategy>(*plugin);
+
+        loaded().emplace_back(plugin->name, std::move(strategy));
+        return true;
+    }
+
+    /**
+     * @brief Load every plugin listed in the SFE_PLUGINS environment variable (colon-separated).
+     * 
+     * @return true if all listed plugins were loaded.
+     */
+    static bool loadFromEnvironment()
+    {
+        const char *paths = std::getenv("SFE_PLUGINS");
+        bool ok = true;
+        for (std::string list = paths ? paths : ""; !list.empty();)
+        {
+            const size_t end = list.find(':');
+            const std::string path = list.substr(0, end);
+            if (!path.empty() && !load(path))
+                ok = false;
+            list = end == std::string::npos ? "" : list.substr(end + 1);
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Look up a loaded plugin strategy by name.
+     * 
+     * @param name plugin strategy name.
+     * @return strategy adapter, or nullptr if no loaded plugin has that name.
+     */
+    static StrategyHandle find(const std::string &name)
+    {
+        for (const auto &plugin : loaded())
+        {
+            if (plugin.first == name)
+            {
+                return plugin.second;
+            }
+        }
+        return nullptr;
+    }
+
+private:
+    static std::vector<std::pair<std::string, StrategyHandle>> &loaded()
+    {
+        static std::vector<std::pair<std::string, StrategyHandle>> plugins;
+        return plugins;
+    }
+};
+
+/** @brief Named entry of the built-in strategy registry. */
+struct StrategyRegistration
+{
+    /** @brief Strategy name used on the command line and by worker processes. */
+    const char *name;
+
+    /** @brief Accessor of the shared strategy object, constructed on first use. */
+    StrategyHandle (*instance)();
+
+    /** @brief Dynamic type of the strategy, identifying it without constructing it. */
+    const std::type_info *type;
+};
+
+/**
+ * @brief Shared instance of a strategy, constructed on first use only.
+ * 
+ * @return handle to the strategy object.
+ */
+template <typename Strategy>
+StrategyHandle strategyInstance()
+{
+    static const StrategyHandle strategy = std::make_shared<const Strategy>();
+    return strategy;
+}
+
+/**
+ * @brief Built-in strategies by name. Constant-initialized: no strategy object is
+ * constructed at startup, only the one that is looked up.
+ */
+constexpr StrategyRegistration strategyRegistry[]{
+    {"xor", strategyInstance<XOREncryptionStrategy>, &typeid(XOREncryptionStrategy)},
+    {"caesar", strategyInstance<CaesarEncryptionStrategy>, &typeid(CaesarEncryptionStrategy)},
+    {"vigenere", strategyInstance<VigenereEncryptionStrategy>, &typeid(VigenereEncryptionStrategy)},
+    {"binary", strategyInstance<BinaryEncryptionStrategy>, &typeid(BinaryEncryptionStrategy)},
+    {"keystream", strategyInstance<KeystreamXOREncryptionStrategy>, &typeid(KeystreamXOREncryptionStrategy)},
+    {"substitution", strategyInstance<SubstitutionEncryptionStrategy>, &typeid(SubstitutionEncryptionStrategy)},
+};
+
+/**
+ * @brief Look up a built-in or loaded plugin strategy by name.
+ * 
+ * @param name strategy name.
+ * @return handle to the shared strategy object, or nullptr for an unknown name.
+ */
+inline StrategyHandle findStrategy(const std::string &name)
+{
+    for (const auto &registration : strategyRegistry)
+    {
+        if (name == registration.name)
+        {
+            return registration.instance();
+        }
+    }
+    return StrategyPlugins::find(name);
+}
+
+/**
+ * @brief Stable numeric id of a strategy, for probes. Compares dynamic types, so no
+ * registered strategy is constructed.
+ * 
+ * @param strategy strategy object.
+ * @return index in strategyRegistry, or -1 for plugins and other strategies.
+ */
+inline int strategyId(const EncryptionStrategy *strategy)
+{
+    if (!strategy)
+        return -1;
+    for (size_t i = 0; i < sizeof(strategyRegistry) / sizeof(strategyRegistry[0]); i++)
+    {
+        if (typeid(*strategy) == *strategyRegistry[i].type)
+        {
+            return int(i);
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief USDT strategy__entry(id, direction, key length) on construction and
+ * strategy__exit(id, direction, bytes, ok) on destruction, around one job. The strategy id
+ * is looked up only while one of the two probes is attached, and is -1 otherwise.
+ */
+class StrategyProbe
+{
+public:
+    /** @brief Direction argument of the probes. */
+    enum Direction
+    {
+        Encrypt,
+        Decrypt,
+        Rekey,
+    };
+
+    /**
+     * @brief Fire strategy__entry.
+     * 
+     * @param strategy strategy of the job.
+     * @param direction encryption, decryption or re-keying.
+     * @param keySize key length in bytes.
+     */
+    StrategyProbe(const EncryptionStrategy *strategy, Direction direction, size_t keySize)
+        : id{SFE_PROBE_ENABLED(strategy__entry) || SFE_PROBE_ENABLED(strategy__exit) ? strategyId(strategy) : -1}, direction{direction}
+    {
+        SFE_PROBE(strategy__entry, id, int(direction), keySize);
+        (void)keySize;
+    }
+
+    StrategyProbe(const StrategyProbe &) = delete;
+    StrategyProbe &operator=(const StrategyProbe &) = delete;
+
+    /** @brief Fire strategy__exit. */
+    ~StrategyProbe()
+    {
+        SFE_PROBE(strategy__exit, id, int(direction), bytes.load(std::memory_order_relaxed), ok);
+    }
+
+    /**
+     * @brief Count transformed bytes; callable from any worker thread.
+     * 
+     * @param size number of bytes.
+     */
+    void add(size_t size) { bytes.fetch_add(size, std::memory_order_relaxed); }
+
+    /**
+     * @brief Record the outcome of the job.
+     * 
+     * @param success job result.
+     * @return success, so it can wrap a return value.
+     */
+    bool finish(bool success)
+    {
+        ok = success;
+        return success;
+    }
+
+private:
+    int id;
+    Direction direction;
+    std::atomic<size_t> bytes{0};
+    bool ok = false;
+};
+
+/**
+ * @brief Output stream buffer encrypting everything written through it.
+ *
+ * Bytes are collected in a large internal buffer and encrypted in place, chunk by chunk,
+ * with the strategy's vectorized kernels before being passed on to the underlying
+ * stream buffer or file descriptor. The stream offset selects the key phase of each chunk.
+ *
+ * @code
+ * std::ofstream file("secret.txt", std::ios::binary);
+ * EncryptingStreambuf encrypting(file.rdbuf(), strategy, key);
+ * std::ostream(&encrypting) << "text";
+ * @endcode
+ */
+class EncryptingStreambuf : public std::streambuf
+{
+public:
+    /**
+     * @brief Wrap a stream buffer.
+     * 
+     * @param sink stream buffer receiving the encrypted bytes.
+     * @param strategy length-preserving strategy.
+     * @param key key string.
+     * @param bufferSize internal buffer size.
+     */
+    EncryptingStreambuf(std::streambuf *sink, std::shared_ptr<const LengthPreservingEncryptionStrategy> strategy, std::string key, size_t bufferSize = fileio::ChunkSize)
+        : sink{sink}, strategy{std::move(strategy)}, key{std::move(key)}, job{*this->strategy, this->key, false},
+          buffer(std::max<size_t>(1, bufferSize))
+    {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    /**
+     * @brief Wrap a file descriptor (file, pipe or socket); the descriptor is not closed.
+     * 
+     * @param fd descriptor receiving the encrypted bytes.
+     * @param strategy length-preserving strategy.
+     * @param key key string.
+     * @param bufferSize internal buffer size.
+     */
+    EncryptingStreambuf(int fd, std::shared_ptr<const LengthPreservingEncryptionStrategy> strategy, std::string key, size_t bufferSize = fileio::ChunkSize)
+        : EncryptingStreambuf(static_cast<std::streambuf *>(nullptr), std::move(strategy), std::move(key), bufferSize)
+    {
+        this->fd = fd;
+    }
+
+    ~EncryptingStreambuf() override { flush(); }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (!flush())
+            return traits_type::eof();
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override
+    {
+        return flush() && (!sink || sink->pubsync() == 0) ? 0 : -1;
+    }
+
+private:
+    std::streambuf *sink;
+    int fd = -1;
+    std::shared_ptr<const LengthPreservingEncryptionStrategy> strategy;
+    std::string key;
+    LengthPreservingEncryptionStrategy::Job job;
+    std::vector<char> buffer;
+    size_t offset = 0;
+
+    /** @brief Encrypt and pass on the buffered bytes. */
+    bool flush()
+    {
+        const size_t size = size_t(pptr() - pbase());
+        if (!size)
+            return true;
+
+        job(pbase(), pbase(), size, offset);
+        const bool written = sink ? size_t(sink->sputn(pbase(), std::streamsize(size))) == size
+                                  : fileio::writeAll(fd, pbase(), size);
+        offset += size;
+        setp(buffer.data(), buffer.data() + buffer.size());
+        return written;
+    }
+};
+
+/**
+ * @brief Input stream buffer decrypting everything read through it.
+ *
+ * Encrypted bytes are read from the underlying stream buffer or file descriptor into a
+ * large internal buffer and decrypted in place, one chunk at a time, so a legacy reader
+ * consumes an encrypted file lazily without a temporary file or a whole-file string.
+ * Seeking is supported when the source is seekable.
+ *
+ * @code
+ * std::ifstream file("secret.txt", std::ios::binary);
+ * DecryptingStreambuf decrypting(file.rdbuf(), strategy, key);
+ * std::istream in(&decrypting);
+ * for (std::string line; std::getline(in, line);) ...
+ * @endcode
+ */
+class DecryptingStreambuf : public std::streambuf
+{
+public:
+    /**
+     * @brief Wrap a stream buffer.
+     * 
+     * @param source stream buffer providing the encrypted bytes.
+     * @param strategy length-preserving strategy.
+     * @param key key string.
+     * @param bufferSize internal buffer size.
+     */
+    DecryptingStreambuf(std::streambuf *source, std::shared_ptr<const LengthPreservingEncryptionStrategy> strategy, std::string key, size_t bufferSize = fileio::ChunkSize)
+        : source{source}, strategy{std::move(strategy)}, key{std::move(key)}, job{*this->strategy, this->key, true},
+          buffer(std::max<size_t>(1, bufferSize))
+    {
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+
+    /**
+     * @brief Wrap a file descriptor (file, pipe or socket); the descriptor is not closed.
+     * 
+     * @param fd descriptor providing the encrypted bytes.
+     * @param strategy length-preserving strategy.
+     * @param key key string.
+     * @param bufferSize internal buffer size.
+     */
+    DecryptingStreambuf(int fd, std::shared_ptr<const LengthPreservingEncryptionStrategy> strategy, std::string key, size_t bufferSize = fileio::ChunkSize)
+        : DecryptingStreambuf(static_cast<std::streambuf *>(nullptr), std::move(strategy), std::move(key), bufferSize)
+    {
+        this->fd = fd;
+    }
+
+protected:
+    int_type underflow() override
+    {
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+
+        offset += size_t(egptr() - eback());
+        size_t size = 0;
+        if (source)
+        {
+            size = size_t(std::max<std::streamsize>(0, source->sgetn(buffer.data(), std::streamsize(buffer.size()))));
+        }
+        else
+        {
+            ssize_t done;
+            while ((done = ::read(fd, buffer.data() + size, buffer.size() - size)) > 0)
+            {
+                size += size_t(done);
+                if (size == buffer.size())
+                    break;
+            }
+        }
+
+        setg(buffer.data(), buffer.data(), buffer.data() + size);
+        if (!size)
+            return traits_type::eof();
+
+        job(buffer.data(), buffer.data(), size, offset);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (dir == std::ios_base::cur)
+        {
+            // tellg() lands here with off 0: answered from the buffer, also on pipes.
+            off += off_type(offset + size_t(gptr() - eback()));
+            dir = std::ios_base::beg;
+        }
+        if (dir == std::ios_base::beg)
+            return seekpos(pos_type(off), which);
+
+        // Only the end position is wanted: the source goes back to the end of the decrypted
+        // chunk, where seekpos and underflow expect it.
+        const pos_type failed = pos_type(off_type(-1));
+        const pos_type current = source ? source->pubseekoff(0, std::ios_base::cur, std::ios_base::in) : pos_type(off_type(::lseek(fd, 0, SEEK_CUR)));
+        if (current == failed)
+            return failed;
+        const pos_type end = source ? source->pubseekoff(off, dir, std::ios_base::in) : pos_type(off_type(::lseek(fd, off, SEEK_END)));
+        const pos_type restored = source ? source->pubseekpos(current, std::ios_base::in) : pos_type(off_type(::lseek(fd, off_type(current), SEEK_SET)));
+        if (end == failed || restored == failed)
+            return failed;
+        return seekpos(end, which);
+    }
+
+    pos_type seekpos(pos_type position, std::ios_base::openmode) override
+    {
+        // Inside the decrypted chunk only the get pointer moves; the source stays at its end.
+        const off_type target = off_type(position);
+        if (target >= off_type(offset) && target <= off_type(offset + size_t(egptr() - eback())))
+        {
+            setg(eback(), eback() + (target - off_type(offset)), egptr());
+            return position;
+        }
+
+        const pos_type done = source ? source->pubseekpos(position, std::ios_base::in) : pos_type(off_type(::lseek(fd, off_type(position), SEEK_SET)));
+        if (done == pos_type(off_type(-1)))
+            return done;
+
+        offset = size_t(off_type(position));
+        setg(buffer.data(), buffer.data(), buffer.data());
+        return position;
+    }
+
+private:
+    std::streambuf *source;
+    int fd = -1;
+    std::shared_ptr<const LengthPreservingEncryptionStrategy> strategy;
+    std::string key;
+    LengthPreservingEncryptionStrategy::Job job;
+    std::vector<char> buffer;
+    size_t offset = 0;
+};
+
+#if __cplusplus >= 202002L && defined(__cpp_lib_ranges)
+/**
+ * @brief Lazy C++20 range adaptors for the strategies.
+ *
+ * Transformations compose without intermediate strings and in bounded memory:
+ *
+ * @code
+ * for (char ch : views::file_view("secret.txt") | views::xor_view(key, true) | views::binary_view) ...
+ * @endcode
+ *
+ * Each adaptor works on blocks of BlockSize input bytes. A block is taken straight from
+ * the underlying memory when the range is contiguous (a file mapping, a string), or as the
+ * previous adaptor's output block when adaptors are chained, and handed to the strategy's
+ * vectorized chunk kernel in one call; only other ranges are copied byte by byte.
+ */
+namespace views
+{
+    /** @brief Input bytes transformed per block. */
+    constexpr size_t BlockSize = size_t(64) << 10;
+
+    /** @brief A range that hands out its transformed output one contiguous block at a time. */
+    template <typename R>
+    concept chunked_source = requires(R &range) {
+        { range.next_chunk() } -> std::same_as<std::span<const char>>;
+    };
+
+    /** @brief Block transform applying a length-preserving strategy. */
+    struct strategy_transform
+    {
+        /** @brief Output bytes per input byte. */
+        static constexpr size_t expansion = 1;
+
+        std::shared_ptr<const LengthPreservingEncryptionStrategy> strategy;
+        std::string key;
+        bool decrypt = false;
+        /** @brief Job state from prepareJob, shared by the copies of the adaptor. */
+        std::shared_ptr<void> state;
+
+        void operator()(const char *in, char *out, size_t size, size_t offset) const
+        {
+            strategy->transformChunk(state.get(), in, out, size, offset, key, decrypt);
+        }
+    };
+
+    /**
+     * @brief Block transform producing Binary code, same output as BinaryEncryptionStrategy::encrypt,
+     * with the same kernel. Blocks are always contiguous: bytes of other ranges are gathered first.
+     */
+    struct binary_transform
+    {
+        /** @brief Output bytes per input byte. */
+        static constexpr size_t expansion = 8;
+
+        void operator()(const char *in, char *out, size_t size, size_t) const
+        {
+            kernels::expandBits(in, out, size);
+        }
+    };
+
+
+    /**
+     * @brief Input view transforming the bytes of an underlying range block by block.
+     * Single-pass: iterate it once, or drain it with next_chunk().
+     */
+    template <std::ranges::input_range V, typename Transform>
+        requires std::ranges::view<V> && std::convertible_to<std::ranges::range_reference_t<V>, char>
+    class chunked_transform_view : public std::ranges::view_interface<chunked_transform_view<V, Transform>>
+    {
+    public:
+        /** @brief Iterator over the transformed bytes. */
+        class iterator
+        {
+        public:
+            using value_type = char;
+            using difference_type = std::ptrdiff_t;
+
+            iterator() = default;
+            explicit iterator(chunked_transform_view *parent) : parent{parent} {}
+
+            char operator*() const { return parent->output[parent->position]; }
+
+            iterator &operator++()
+            {
+                if (++parent->position == parent->available)
+                {
+                    parent->refill();
+                }
+                return *this;
+            }
+
+            void operator++(int) { ++*this; }
+
+            friend bool operator==(const iterator &it, std::default_sentinel_t) { return it.atEnd(); }
+
+        private:
+            chunked_transform_view *parent = nullptr;
+
+            bool atEnd() const { return parent->position == parent->available; }
+        };
+
+        chunked_transform_view() = default;
+        chunked_transform_view(V base, Transform transform) : base{std::move(base)}, transform{std::move(transform)} {}
+
+        iterator begin()
+        {
+            start();
+            return iterator{this};
+        }
+
+        std::default_sentinel_t end() const { return {}; }
+
+        /**
+         * @brief Take the rest of the current output block and move on to the next one.
+         * 
+         * @return transformed bytes, valid until the next call; empty at the end.
+         */
+        std::span<const char> next_chunk()
+        {
+            start();
+            if (position == available)
+            {
+                refill();
+            }
+            const std::span<const char> chunk(output.data() + position, available - position);
+            position = available;
+            return chunk;
+        }
+
+    private:
+        V base;
+        Transform transform;
+        std::ranges::iterator_t<V> current{};
+        bool started = false;
+        std::vector<char> input, output;
+        size_t position = 0, available = 0, consumed = 0;
+
+        void start()
+        {
+            if (!started)
+            {
+                started = true;
+                if constexpr (!chunked_source<V>)
+                {
+                    current = std::ranges::begin(base);
+                }
+                refill();
+            }
+        }
+
+        void refill()
+        {
+            const char *block = nullptr;
+            size_t size = 0;
+
+            if constexpr (chunked_source<V>)
+            {
+                const std::span<const char> chunk = base.next_chunk();
+                block = chunk.data();
+                size = chunk.size();
+            }
+            else if constexpr (std::ranges::contiguous_range<V> && std::ranges::sized_range<V> &&
+                               std::same_as<std::ranges::range_value_t<V>, char>)
+            {
+                size = std::min(BlockSize, size_t(std::ranges::size(base)) - consumed);
+                block = std::ranges::data(base) + consumed;
+            }
+            else
+            {
+                input.resize(BlockSize);
+                const auto last = std::ranges::end(base);
+                for (; size < BlockSize && current != last; ++current)
+                {
+                    input[size++] = static_cast<char>(*current);
+                }
+                block = input.data();
+            }
+
+            output.resize(size * Transform::expansion);
+            if (size)
+            {
+                transform(block, output.data(), size, consumed);
+            }
+            consumed += size;
+            position = 0;
+            available = output.size();
+        }
+    };
+
+    /** @brief Pipeable adaptor closure creating a chunked_transform_view. */
+    template <typename Transform>
+    struct adaptor
+    {
+        Transform transform;
+
+        template <std::ranges::viewable_range R>
+        friend auto operator|(R &&range, const adaptor &closure)
+        {
+            return chunked_transform_view<std::views::all_t<R>, Transform>(std::views::all(std::forward<R>(range)), closure.transform);
+        }
+    };
+
+    /**
+     * @brief Adaptor applying any length-preserving strategy.
+     * 
+     * @param strategy strategy handle; must be length-preserving.
+     * @param key key string.
+     * @param decrypt decrypt instead of encrypt.
+     */
+    inline adaptor<strategy_transform> strategy_view(const StrategyHandle &strategy, std::string key, bool decrypt = false)
+    {
+        auto chunked = std::dynamic_pointer_cast<const LengthPreservingEncryptionStrategy>(strategy);
+        if (!chunked)
+        {
+            throw std::invalid_argument("strategy_view needs a length-preserving strategy");
+        }
+        std::shared_ptr<void> state = chunked->prepareJob(key, decrypt);
+        return {{std::move(chunked), std::move(key), decrypt, std::move(state)}};
+
+    }
+
+    /** @brief XOR adaptor. */
+    inline adaptor<strategy_transform> xor_view(std::string key, bool decrypt = false) { return strategy_view(findStrategy("xor"), std::move(key), decrypt); }
+
+    /** @brief Caesar adaptor. */
+    inline adaptor<strategy_transform> caesar_view(std::string key, bool decrypt = false) { return strategy_view(findStrategy("caesar"), std::move(key), decrypt); }
+
+    /** @brief Vigenere adaptor. */
+    inline adaptor<strategy_transform> vigenere_view(std::string key, bool decrypt = false) { return strategy_view(findStrategy("vigenere"), std::move(key), decrypt); }
+
+    /** @brief Keystream XOR adaptor. */
+    inline adaptor<strategy_transform> keystream_view(std::string key, bool decrypt = false) { return strategy_view(findStrategy("keystream"), std::move(key), decrypt); }
+
+    /** @brief Byte substitution adaptor. */
+    inline adaptor<strategy_transform> substitution_view(std::string key, bool decrypt = false) { return strategy_view(findStrategy("substitution"), std::move(key), decrypt); }
+
+    /** @brief Binary code adaptor (encoding only: eight '0'/'1' characters per byte). */
+    inline constexpr adaptor<binary_transform> binary_view{};
+
+    /** @brief Contiguous, memory-mapped view of a file's bytes. */
+    class file_view : public std::ranges::view_interface<file_view>
+    {
+    public:
+        file_view() = default;
+
+        /**
+         * @brief Map a file.
+         * 
+         * @param path path to the file; an unreadable file gives an empty view.
+         */
+        explicit file_view(const std::string &path) : file{std::make_shared<fileio::MappedFile>(path)} {}
+
+        const char *begin() const { return file ? file->data() : nullptr; }
+        const char *end() const { return file && file->data() ? file->data() + file->length() : begin(); }
+
+    private:
+        std::shared_ptr<fileio::MappedFile> file;
+    };
+
+    /**
+     * @brief Consume a range block by block: chained adaptors hand over their output
+     * blocks, contiguous ranges are passed whole, other ranges are gathered into blocks.
+     * 
+     * @param range range of bytes.
+     * @param fn callable taking std::span<const char>.
+     */
+    template <std::ranges::input_range R, typename Fn>
+    void for_each_chunk(R &&range, Fn &&fn)
+    {
+        if constexpr (chunked_source<std::remove_reference_t<R>>)
+        {
+            for (std::span<const char> chunk = range.next_chunk(); !chunk.empty(); chunk = range.next_chunk())
+            {
+                fn(chunk);
+            }
+        }
+        else if constexpr (std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+                           std::same_as<std::ranges::range_value_t<R>, char>)
+        {
+            fn(std::span<const char>(std::ranges::data(range), size_t(std::ranges::size(range))));
+        }
+        else
+        {
+            std::vector<char> block;
+            block.reserve(BlockSize);
+            for (auto &&ch : range)
+            {
+                block.push_back(static_cast<char>(ch));
+                if (block.size() == BlockSize)
+                {
+                    fn(std::span<const char>(block));
+                    block.clear();
+                }
+            }
+            if (!block.empty())
+            {
+                fn(std::span<const char>(block));
+            }
+        }
+    }
+}
+#endif
+
+/**
+ * @brief Passphrase-based key derivation (PBKDF2-HMAC-SHA256) for containers that start with
+ * a header recording the salt and the parameters.
+ */
+namespace kdf
+{
+    /** @brief Portable SHA-256 (FIPS 180-4). */
+    class Sha256
+    {
+    public:
+        /** @brief Digest size in bytes. */
+        static constexpr size_t DigestSize = 32;
+
+        /** @brief Block size in bytes. */
+        static constexpr size_t BlockSize = 64;
+
+        Sha256() { reset(); }
+
+        /** @brief Start a new message. */
+        void reset()
+        {
+            static constexpr std::uint32_t initial[8]{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                                      0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+            std::copy(std::begin(initial), std::end(initial), state);
+            length = 0;
+            buffered = 0;
+        }
+
+        /**
+         * @brief Hash more of the message.
+         * 
+         * @param data bytes.
+         * @param size number of bytes.
+         */
+        void update(const void *data, size_t size)
+        {
+            auto bytes = static_cast<const std::uint8_t *>(data);
+            length += size;
+            while (size)
+            {
+                const size_t take = std::min(size, BlockSize - buffered);
+                std::memcpy(block + buffered, bytes, take);
+                buffered += take;
+                bytes += take;
+                size -= take;
+                if (buffered == BlockSize)
+                {
+                    compress(block);
+                    buffered = 0;
+                }
+            }
+        }
+
+        /**
+         * @brief Finish the message.
+         * 
+         * @param digest receives DigestSize bytes.
+         */
+        void finish(std::uint8_t *digest)
+        {
+            const std::uint64_t bits = length * 8;
+            const std::uint8_t one = 0x80, zero = 0;
+            update(&one, 1);
+            while (buffered != BlockSize - 8)
+            {
+                update(&zero, 1);
+            }
+            std::uint8_t tail[8];
+            for (int i = 0; i < 8; i++)
+            {
+                tail[i] = std::uint8_t(bits >> (56 - 8 * i));
+            }
+            update(tail, sizeof(tail));
+
+            for (int i = 0; i < 8; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    digest[4 * i + j] = std::uint8_t(state[i] >> (24 - 8 * j));
+                }
+            }
+        }
+
+        /**
+         * @brief Hash a whole message.
+         * 
+         * @param text message.
+         * @return DigestSize bytes.
+         */
+        static std::string digest(const std::string &text)
+        {
+            Sha256 hash;
+            hash.update(text.data(), text.size());
+            std::string digest(DigestSize, '\0');
+            hash.finish(reinterpret_cast<std::uint8_t *>(&digest[0]));
+            return digest;
+        }
+
+    private:
+        std::uint32_t state[8];
+        std::uint8_t block[BlockSize];
+        std::uint64_t length;
+        size_t buffered;
+
+        static std::uint32_t rotr(std::uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+        void compress(const std::uint8_t *data)
+        {
+            static constexpr std::uint32_t k[64]{
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+            std::uint32_t w[64];
+            for (int i = 0; i < 16; i++)
+            {
+                w[i] = std::uint32_t(data[4 * i]) << 24 | std::uint32_t(data[4 * i + 1]) << 16 |
+                       std::uint32_t(data[4 * i + 2]) << 8 | std::uint32_t(data[4 * i + 3]);
+            }
+            for (int i = 16; i < 64; i++)
+            {
+                const std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                const std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+                w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+            }
+
+            std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (int i = 0; i < 64; i++)
+            {
+                const std::uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+                const std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+            state[0] += a;
+            state[1] += b;
+            state[2] += c;
+            state[3] += d;
+            state[4] += e;
+            state[5] += f;
+            state[6] += g;
+            state[7] += h;
+        }
+    };
+
+    /** @brief HMAC-SHA256 (RFC 2104) with the keyed inner and outer states computed once. */
+    class HmacSha256
+    {
+    public:
+        /**
+         * @brief Key the MAC.
+         * 
+         * @param key key bytes.
+         */
+        explicit HmacSha256(const std::string &key)
+        {
+            std::uint8_t block[Sha256::BlockSize] = {};
+            if (key.size() > Sha256::BlockSize)
+            {
+                const std::string hashed = Sha256::digest(key);
+                std::memcpy(block, hashed.data(), hashed.size());
+            }
+            else
+            {
+                std::memcpy(block, key.data(), key.size());
+            }
+
+            std::uint8_t pad[Sha256::BlockSize];
+            for (size_t i = 0; i < sizeof(pad); i++)
+                pad[i] = block[i] ^ 0x36;
+            inner.update(pad, sizeof(pad));
+            for (size_t i = 0; i < sizeof(pad); i++)
+                pad[i] = block[i] ^ 0x5c;
+            outer.update(pad, sizeof(pad));
+        }
+
+        /**
+         * @brief MAC of one message.
+         * 
+         * @param data message bytes.
+         * @param size number of bytes.
+         * @param digest receives Sha256::DigestSize bytes (may alias data).
+         */
+        void compute(const std::uint8_t *data, size_t size, std::uint8_t *digest) const
+        {
+            Sha256 hash = inner;
+            hash.update(data, size);
+            hash.finish(digest);
+            hash = outer;
+            hash.update(digest, Sha256::DigestSize);
+            hash.finish(digest);
+        }
+
+        /**
+         * @brief MAC of one message.
+         * 
+         * @param message message bytes.
+         * @return Sha256::DigestSize bytes.
+         */
+        std::string compute(const std::string &message) const
+        {
+            std::string digest(Sha256::DigestSize, '\0');
+            compute(reinterpret_cast<const std::uint8_t *>(message.data()), message.size(), reinterpret_cast<std::uint8_t *>(&digest[0]));
+            return digest;
+        }
+
+    private:
+        Sha256 inner, outer;
+    };
+
+    /**
+     * @brief PBKDF2 (RFC 8018) with HMAC-SHA256; every iteration costs two compressions.
+     * 
+     * @param passphrase password bytes.
+     * @param salt salt bytes.
+     * @param iterations iteration count, at least 1.
+     * @param size derived key size in bytes.
+     * @return derived key.
+     */
+    inline std::string pbkdf2Sha256(const std::string &passphrase, const std::string &salt, std::uint32_t iterations, size_t size)
+    {
+        const HmacSha256 hmac(passphrase);
+        std::string derived;
+        for (std::uint32_t blockIndex = 1; derived.size() < size; blockIndex++)
+        {
+            std::string first = salt;
+            for (int shift = 24; shift >= 0; shift -= 8)
+            {
+                first += char(std::uint8_t(blockIndex >> shift));
+            }
+
+            std::uint8_t u[Sha256::DigestSize], t[Sha256::DigestSize];
+            hmac.compute(reinterpret_cast<const std::uint8_t *>(first.data()), first.size(), u);
+            std::memcpy(t, u, sizeof(t));
+            for (std::uint32_t i = 1; i < iterations; i++)
+            {
+                hmac.compute(u, sizeof(u), u);
+                for (size_t j = 0; j < sizeof(t); j++)
+                    t[j] ^= u[j];
+            }
+            derived.append(reinterpret_cast<const char *>(t), std::min(sizeof(t), size - derived.size()));
+        }
+        return derived;
+    }
+
+    /**
+     * @brief HKDF (RFC 5869) with HMAC-SHA256: extract with the salt, then expand.
+     * 
+     * @param secret input key material.
+     * @param salt salt bytes.
+     * @param info context string.
+     * @param size output size in bytes, at most 255 * 32.
+     * @return derived key.
+     */
+    inline std::string hkdfSha256(const std::string &secret, const std::string &salt, const std::string &info, size_t size)
+    {
+        const HmacSha256 expand(HmacSha256(salt).compute(secret));
+        std::string derived, block;
+        for (std::uint8_t counter = 1; derived.size() < size; counter++)
+        {
+            block = expand.compute(block + info + char(counter));
+            derived.append(block, 0, std::min(block.size(), size - derived.size()));
+        }
+        return derived;
+    }
+
+    /** @brief Derivation parameters recorded in the container header. */
+    struct Params
+    {
+        /** @brief PBKDF2 iteration count. */
+        std::uint32_t iterations = 600000;
+
+        /** @brief Salt of the passphrase derivation; empty asks for a fresh random one. Files
+         * sharing it share the expensive derivation, and each still gets its own key. */
+        std::string salt;
+    };
+
+    /** @brief Size of the derived key material. */
+    constexpr size_t DerivedKeySize = 32;
+
+    /** @brief Salt size of freshly generated salts. */
+    constexpr size_t SaltSize = 16;
+
+    /** @return SaltSize random bytes. */
+    inline std::string randomSalt()
+    {
+        std::random_device device;
+        std::string salt(SaltSize, '\0');
+        for (auto &ch : salt)
+        {
+            ch = char(device());
+        }
+        return salt;
+    }
+
+    /**
+     * @brief Container header: magic, algorithm, iterations and salts, little endian.
+     * "SFEKDF1\n" | u32 algorithm | u32 iterations | u32 salt size | salt | u32 file salt size | file salt.
+     */
+    struct Header
+    {
+        static constexpr char Magic[8]{'S', 'F', 'E', 'K', 'D', 'F', '1', '\n'};
+        /** @brief Key = HKDF-SHA256(PBKDF2-HMAC-SHA256(passphrase, salt), file salt), the only algorithm. */
+        static constexpr std::uint32_t Pbkdf2HkdfSha256 = 2;
+        static constexpr size_t MaxSaltSize = 1024;
+        /** @brief Bound on the iteration count, so a crafted header cannot stall the reader. */
+        static constexpr std::uint32_t MaxIterations = 10000000;
+
+        Params params;
+        std::string fileSalt;
+
+        /** @return serialized header. */
+        std::string serialize() const
+        {
+            std::string bytes(Magic, sizeof(Magic));
+            const auto append = [&](std::uint32_t value)
+            {
+                for (int shift = 0; shift < 32; shift += 8)
+                {
+                    bytes += char(std::uint8_t(value >> shift));
+                }
+            };
+            append(Pbkdf2HkdfSha256);
+            append(params.iterations);
+            append(std::uint32_t(params.salt.size()));
+            bytes += params.salt;
+            append(std::uint32_t(fileSalt.size()));
+            bytes += fileSalt;
+            return bytes;
+        }
+
+        /**
+         * @brief Read a header from the start of a file.
+         * 
+         * @param fd file descriptor.
+         * @param size receives the header size in bytes.
+         * @return false if the file does not start with a supported header.
+         */
+        bool read(int fd, size_t &size)
+        {
+            char fixed[sizeof(Magic) + 12];
+            if (!fileio::readAt(fd, fixed, sizeof(fixed), 0) || std::memcmp(fixed, Magic, sizeof(Magic)) != 0)
+                return false;
+
+            const auto value = [](const char *bytes)
+            {
+                std::uint32_t result = 0;
+                for (int j = 0; j < 4; j++)
+                {
+                    result |= std::uint32_t(std::uint8_t(bytes[j])) << (8 * j);
+                }
+                return result;
+            };
+            const std::uint32_t algorithm = value(fixed + sizeof(Magic));
+            params.iterations = value(fixed + sizeof(Magic) + 4);
+            const std::uint32_t saltSize = value(fixed + sizeof(Magic) + 8);
+            if (algorithm != Pbkdf2HkdfSha256 || params.iterations == 0 || params.iterations > MaxIterations || saltSize > MaxSaltSize)
+                return false;
+
+            params.salt.assign(saltSize, '\0');
+            size = sizeof(fixed) + saltSize;
+            if (!fileio::readAt(fd, &params.salt[0], saltSize, sizeof(fixed)))
+                return false;
+
+            char sizeBytes[4];
+            if (!fileio::readAt(fd, sizeBytes, sizeof(sizeBytes), size) || value(sizeBytes) > MaxSaltSize)
+                return false;
+            fileSalt.assign(value(sizeBytes), '\0');
+            size += sizeof(sizeBytes) + fileSalt.size();
+            return fileio::readAt(fd, &fileSalt[0], fileSalt.size(), size - fileSalt.size());
+        }
+    };
+
+    /** @return number of PBKDF2 derivations run by deriveKey, i.e. cache misses. */
+    inline std::atomic<size_t> &derivations()
+    {
+        static std::atomic<size_t> count{0};
+        return count;
+    }
+
+    /**
+     * @brief Derive key material from a passphrase, once per (passphrase, salt, parameters) in
+     * this process: later calls with the same inputs return the cached result. The cache keeps
+     * a SHA-256 of the passphrase, never the passphrase itself.
+     * 
+     * @param passphrase passphrase.
+     * @param params salt and iteration count.
+     * @return DerivedKeySize bytes.
+     */
+    inline std::string deriveKey(const std::string &passphrase, const Params &params)
+    {
+        static std::mutex mutex;
+        static std::map<std::string, std::string> cache;
+        constexpr size_t MaxEntries = 1024;
+
+        std::string id = Sha256::digest(passphrase);
+        id += std::string(reinterpret_cast<const char *>(&params.iterations), sizeof(params.iterations));
+        id += params.salt;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            const auto found = cache.find(id);
+            if (found != cache.end())
+                return found->second;
+        }
+
+        // Derived outside the lock; two threads racing on a new entry both compute it.
+        std::string derived = pbkdf2Sha256(passphrase, params.salt, std::max<std::uint32_t>(1, params.iterations), DerivedKeySize);
+        derivations().fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache.size() >= MaxEntries)
+            cache.clear();
+        cache.emplace(std::move(id), derived);
+        return derived;
+    }
+
+    /**
+     * @brief Key material of one container.
+     * 
+     * @param passphrase passphrase.
+     * @param header container header.
+     * @return DerivedKeySize bytes: the cached passphrase derivation, expanded with the file salt.
+     */
+    inline std::string fileKey(const std::string &passphrase, const Header &header)
+    {
+        const std::string master = deriveKey(passphrase, header.params);
+        return hkdfSha256(master, header.fileSalt, "sfe container key", DerivedKeySize);
+    }
+}
+
+/**
+ * @brief Portable BLAKE3 (unkeyed hash mode), with AVX2 hashing of eight whole chunks at once.
+ * Chaining values are exposed so a tree of them can be kept and checked piecewise.
+ */
+namespace blake3
+{
+    /** @brief Chaining value: eight little-endian words. */
+    using ChainingValue = std::array<std::uint32_t, 8>;
+
+    /** @brief Bytes per compression block. */
+    constexpr size_t BlockSize = 64;
+
+    /** @brief Bytes per chunk, the leaves of the tree. */
+    constexpr size_t ChunkSize = 1024;
+
+    /** @brief Domain flags. */
+    enum Flags : std::uint32_t
+    {
+        ChunkStart = 1,
+        ChunkEnd = 2,
+        Parent = 4,
+        Root = 8,
+    };
+
+    /** @brief Initial chaining value (the SHA-256 IV). */
+    constexpr ChainingValue IV{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+    /** @brief Message word order of every round: each round permutes the previous one. */
+    struct Schedule
+    {
+        std::uint8_t words[7][16];
+
+        constexpr Schedule() : words{}
+        {
+            constexpr std::uint8_t permutation[16]{2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+            for (int i = 0; i < 16; i++)
+                words[0][i] = std::uint8_t(i);
+            for (int round = 1; round < 7; round++)
+                for (int i = 0; i < 16; i++)
+                    words[round][i] = words[round - 1][permutation[i]];
+        }
+    };
+
+    /** @brief Schedule shared by the scalar and vector compressions. */
+    constexpr Schedule schedule{};
+
+    inline std::uint32_t rotr(std::uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    inline void mix(std::uint32_t *v, int a, int b, int c, int d, std::uint32_t x, std::uint32_t y)
+    {
+        v[a] = v[a] + v[b] + x;
+        v[d] = rotr(v[d] ^ v[a], 16);
+        v[c] = v[c] + v[d];
+        v[b] = rotr(v[b] ^ v[c], 12);
+        v[a] = v[a] + v[b] + y;
+        v[d] = rotr(v[d] ^ v[a], 8);
+        v[c] = v[c] + v[d];
+        v[b] = rotr(v[b] ^ v[c], 7);
+    }
+
+    /**
+     * @brief Compression function.
+     *
+     * @param cv input chaining value.
+     * @param block block bytes, zero-padded to BlockSize.
+     * @param counter chunk index (0 for parents).
+     * @param length bytes of the block actually used.
+     * @param flags domain flags.
+     * @return next chaining value (the first half of the output).
+     */
+    inline ChainingValue compress(const ChainingValue &cv, const std::uint8_t *block, std::uint64_t counter, std::uint32_t length, std::uint32_t flags)
+    {
+        std::uint32_t m[16];
+        for (int i = 0; i < 16; i++)
+        {
+            m[i] = std::uint32_t(block[4 * i]) | std::uint32_t(block[4 * i + 1]) << 8 |
+                   std::uint32_t(block[4 * i + 2]) << 16 | std::uint32_t(block[4 * i + 3]) << 24;
+        }
+
+        std::uint32_t v[16]{cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+                            IV[0], IV[1], IV[2], IV[3], std::uint32_t(counter), std::uint32_t(counter >> 32), length, flags};
+        for (const auto &s : schedule.words)
+        {
+            mix(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+            mix(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+            mix(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+            mix(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+            mix(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+            mix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            mix(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+            mix(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+        }
+
+        ChainingValue next;
+        for (int i = 0; i < 8; i++)
+        {
+            next[i] = v[i] ^ v[i + 8];
+        }
+        return next;
+    }
+
+    /**
+     * @brief Chaining value of one chunk.
+     *
+     * @param data chunk bytes.
+     * @param size chunk size, at most ChunkSize (0 only for the empty message).
+     * @param index chunk index in the message.
+     * @param flags extra flags of the last block (Root for a single-chunk message).
+     * @return chaining value, or the root hash words with Root.
+     */
+    inline ChainingValue chunk(const char *data, size_t size, std::uint64_t index, std::uint32_t flags = 0)
+    {
+        ChainingValue cv = IV;
+        size_t offset = 0;
+        do
+        {
+            const size_t length = std::min(BlockSize, size - offset);
+            std::uint8_t block[BlockSize] = {};
+            if (length)
+                std::memcpy(block, data + offset, length);
+            const bool last = offset + length == size;
+            cv = compress(cv, block, index, std::uint32_t(length),
+                          (offset == 0 ? std::uint32_t(ChunkStart) : 0) | (last ? ChunkEnd | flags : 0));
+            offset += length;
+        } while (offset < size);
+        return cv;
+    }
+
+    /**
+     * @brief Chaining value of a parent node.
+     *
+     * @param left left child.
+     * @param right right child.
+     * @param flags extra flags (Root for the root node).
+     * @return chaining value, or the root hash words with Root.
+     */
+    inline ChainingValue parent(const ChainingValue &left, const ChainingValue &right, std::uint32_t flags = 0)
+    {
+        std::uint8_t block[BlockSize];
+        for (int i = 0; i < 8; i++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                block[4 * i + j] = std::uint8_t(left[i] >> (8 * j));
+                block[32 + 4 * i + j] = std::uint8_t(right[i] >> (8 * j));
+            }
+        }
+        return compress(IV, block, 0, BlockSize, Parent | flags);
+    }
+
+#ifdef SFE_X86_SIMD
+    template <int Bits>
+    __attribute__((target("avx2"))) inline __m256i rotr8x(__m256i x)
+    {
+        if constexpr (Bits == 16)
+            return _mm256_shuffle_epi8(x, _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+        else if constexpr (Bits == 8)
+            return _mm256_shuffle_epi8(x, _mm256_setr_epi8(1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12,
+                                                           1, 2, 3, 0, 5, 6, 7, 4, 9, 10, 11, 8, 13, 14, 15, 12));
+        else
+            return _mm256_or_si256(_mm256_srli_epi32(x, Bits), _mm256_slli_epi32(x, 32 - Bits));
+    }
+
+    __attribute__((target("avx2"))) inline void mix8x(__m256i *v, int a, int b, int c, int d, __m256i x, __m256i y)
+    {
+        v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), x);
+        v[d] = rotr8x<16>(_mm256_xor_si256(v[d], v[a]));
+        v[c] = _mm256_add_epi32(v[c], v[d]);
+        v[b] = rotr8x<12>(_mm256_xor_si256(v[b], v[c]));
+        v[a] = _mm256_add_epi32(_mm256_add_epi32(v[a], v[b]), y);
+        v[d] = rotr8x<8>(_mm256_xor_si256(v[d], v[a]));
+        v[c] = _mm256_add_epi32(v[c], v[d]);
+        v[b] = rotr8x<7>(_mm256_xor_si256(v[b], v[c]));
+    }
+
+    /**
+     * @brief Chaining values of eight consecutive whole chunks with AVX2, one chunk per
+     * 32-bit lane; message words are gathered across the chunks.
+     *
+     * @param data 8 * ChunkSize bytes.
+     * @param index chunk index of the first chunk.
+     * @param out receives the eight chaining values.
+     */
+    __attribute__((target("avx2"))) inline void chunks8AVX2(const char *data, std::uint64_t index, ChainingValue *out)
+    {
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i strides = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(int(ChunkSize)));
+        const __m256i counterLow = _mm256_add_epi32(_mm256_set1_epi32(int(std::uint32_t(index))), lanes);
+        // Carry into the high word where the low word wrapped around.
+        const __m256i wrapped = _mm256_cmpgt_epi32(_mm256_xor_si256(_mm256_set1_epi32(int(std::uint32_t(index))), _mm256_set1_epi32(INT32_MIN)),
+                                                   _mm256_xor_si256(counterLow, _mm256_set1_epi32(INT32_MIN)));
+        const __m256i counterHigh = _mm256_sub_epi32(_mm256_set1_epi32(int(std::uint32_t(index >> 32))), wrapped);
+
+        __m256i h[8];
+        for (int i = 0; i < 8; i++)
+            h[i] = _mm256_set1_epi32(int(IV[i]));
+
+        for (size_t block = 0; block < ChunkSize / BlockSize; block++)
+        {
+            __m256i m[16];
+            for (int i = 0; i < 16; i++)
+                m[i] = _mm256_i32gather_epi32(reinterpret_cast<const int *>(data + block * BlockSize + 4 * i), strides, 1);
+
+            const std::uint32_t flags = (block == 0 ? std::uint32_t(ChunkStart) : 0) | (block + 1 == ChunkSize / BlockSize ? std::uint32_t(ChunkEnd) : 0);
+            __m256i v[16]{h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7],
+                          _mm256_set1_epi32(int(IV[0])), _mm256_set1_epi32(int(IV[1])), _mm256_set1_epi32(int(IV[2])), _mm256_set1_epi32(int(IV[3])),
+                          counterLow, counterHigh, _mm256_set1_epi32(int(BlockSize)), _mm256_set1_epi32(int(flags))};
+            for (const auto &s : schedule.words)
+            {
+                mix8x(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+                mix8x(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+                mix8x(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+                mix8x(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+                mix8x(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+                mix8x(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+                mix8x(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+                mix8x(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+            }
+            for (int i = 0; i < 8; i++)
+                h[i] = _mm256_xor_si256(v[i], v[i + 8]);
+        }
+
+        alignas(32) std::uint32_t words[8][8];
+        for (int i = 0; i < 8; i++)
+            _mm256_store_si256(reinterpret_cast<__m256i *>(words[i]), h[i]);
+        for (int lane = 0; lane < 8; lane++)
+            for (int i = 0; i < 8; i++)
+                out[lane][i] = words[i][lane];
+    }
+#endif
+
+    /**
+     * @brief Chaining values of all chunks of a byte range, eight whole chunks at a time where
+     * the CPU allows.
+     *
+     * @param data bytes, starting at a chunk boundary.
+     * @param size number of bytes, more than 0.
+     * @param index chunk index of the first chunk.
+     * @return one chaining value per chunk.
+     */
+    inline std::vector<ChainingValue> chunks(const char *data, size_t size, std::uint64_t index)
+    {
+        std::vector<ChainingValue> cvs((size + ChunkSize - 1) / ChunkSize);
+        size_t i = 0;
+#ifdef SFE_X86_SIMD
+        if (kernels::cpu().avx2)
+        {
+            for (; (i + 8) * ChunkSize <= size; i += 8)
+                chunks8AVX2(data + i * ChunkSize, index + i, &cvs[i]);
+        }
+#endif
+        for (; i < cvs.size(); i++)
+            cvs[i] = chunk(data + i * ChunkSize, std::min(ChunkSize, size - i * ChunkSize), index + i);
+        return cvs;
+    }
+
+    /**
+     * @brief Merge one level of the tree: adjacent pairs get a parent, an odd last node is
+     * carried up unchanged. Repeated, this gives BLAKE3's tree, whose left subtrees hold a
+     * power of two of chunks.
+     *
+     * @param level nodes of one level, left to right.
+     * @return nodes of the level above.
+     */
+    inline std::vector<ChainingValue> merge(const std::vector<ChainingValue> &level)
+    {
+        std::vector<ChainingValue> above;
+        for (size_t i = 0; i < level.size(); i += 2)
+        {
+            above.push_back(i + 1 < level.size() ? parent(level[i], level[i + 1]) : level[i]);
+        }
+        return above;
+    }
+
+    /**
+     * @brief Chaining value of a subtree, for a range that starts at a chunk index which is a
+     * multiple of a power of two at least as large as its chunk count.
+     *
+     * @param data bytes.
+     * @param size number of bytes, more than 0.
+     * @param index chunk index of the first chunk.
+     * @return chaining value of the subtree root (not finalized).
+     */
+    inline ChainingValue subtree(const char *data, size_t size, std::uint64_t index)
+    {
+        std::vector<ChainingValue> level = chunks(data, size, index);
+        while (level.size() > 1)
+            level = merge(level);
+        return level[0];
+    }
+
+    /**
+     * @brief Root hash from the two top nodes of a tree with more than one chunk.
+     *
+     * @param left left child of the root.
+     * @param right right child of the root.
+     * @return 32-byte hash.
+     */
+    inline std::string root(const ChainingValue &left, const ChainingValue &right)
+    {
+        const ChainingValue words = parent(left, right, Root);
+        std::string bytes(32, '\0');
+        for (int i = 0; i < 32; i++)
+            bytes[i] = char(words[i / 4] >> (8 * (i % 4)));
+        return bytes;
+    }
+
+    /**
+     * @brief BLAKE3 hash of a whole message.
+     *
+     * @param data bytes.
+     * @param size number of bytes.
+     * @return 32-byte hash.
+     */
+    inline std::string hash(const char *data, size_t size)
+    {
+        if (size <= ChunkSize)
+        {
+            const ChainingValue words = chunk(data, size, 0, Root);
+            std::string bytes(32, '\0');
+            for (int i = 0; i < 32; i++)
+                bytes[i] = char(words[i / 4] >> (8 * (i % 4)));
+            return bytes;
+        }
+
+        std::vector<ChainingValue> level = chunks(data, size, 0);
+        while (level.size() > 2)
+            level = merge(level);
+        return root(level[0], level[1]);
+    }
+}
+
+/**
+ * @brief Tree-hash manifest of a file: the BLAKE3 tree cut at GroupSize leaves, with every
+ * node above the leaves kept, so one range is checked by rehashing it and walking its
+ * path to the root: O(range + log n).
+ *
+ * Text format, records of 64 hex digits and a newline at fixed positions after the header:
+ * "sfe-merkle-manifest-1\n<size> <group size> <groups>\n<root>\n", then the leaf chaining
+ * values, then each level above them up to the two children of the root. The root is the
+ * BLAKE3 hash of the whole file.
+ */
+namespace merkle
+{
+    /** @brief Bytes per leaf: a power of two of BLAKE3 chunks, so every leaf is a subtree. */
+    constexpr size_t GroupSize = size_t(1) << 20;
+
+    /** @brief Bytes per record line. */
+    constexpr size_t RecordSize = 65;
+
+    /** @return lowercase hex of bytes. */
+    inline std::string toHex(const std::string &bytes)
+    {
+        static const char digits[] = "0123456789abcdef";
+        std::string hex;
+        for (const auto &ch : bytes)
+        {
+            hex += digits[std::uint8_t(ch) >> 4];
+            hex += digits[std::uint8_t(ch) & 15];
+        }
+        return hex;
+    }
+
+    /** @return little-endian bytes of a chaining value. */
+    inline std::string toBytes(const blake3::ChainingValue &cv)
+    {
+        std::string bytes(32, '\0');
+        for (int i = 0; i < 32; i++)
+            bytes[i] = char(cv[i / 4] >> (8 * (i % 4)));
+        return bytes;
+    }
+
+    /**
+     * @brief Chaining value of one leaf.
+     *
+     * @param data leaf bytes.
+     * @param size leaf size, at most GroupSize and more than 0.
+     * @param group leaf index.
+     * @return chaining value.
+     */
+    inline blake3::ChainingValue leaf(const char *data, size_t size, size_t group)
+    {
+        return blake3::subtree(data, size, std::uint64_t(group) * (GroupSize / blake3::ChunkSize));
+    }
+
+    /** @return node counts of the levels kept, from the leaves up to the children of the root. */
+    inline std::vector<size_t> levelSizes(size_t groups)
+    {
+        std::vector<size_t> sizes{groups};
+        while (sizes.back() > 2)
+            sizes.push_back((sizes.back() + 1) / 2);
+        return sizes;
+    }
+
+    /**
+     * @brief Write the manifest.
+     *
+     * @param path manifest path.
+     * @param size file size in bytes.
+     * @param leaves leaf chaining values.
+     * @param rootHash BLAKE3 hash of the whole file.
+     * @return true if the manifest was written.
+     */
+    inline bool write(const std::string &path, size_t size, std::vector<blake3::ChainingValue> leaves, const std::string &rootHash)
+    {
+        std::ofstream output(path, std::ios::trunc);
+        output << "sfe-merkle-manifest-1\n"
+               << size << ' ' << GroupSize << ' ' << leaves.size() << '\n'
+               << toHex(rootHash) << '\n';
+        for (std::vector<blake3::ChainingValue> level = std::move(leaves);;)
+        {
+            for (const auto &cv : level)
+                output << toHex(toBytes(cv)) << '\n';
+            if (level.size() <= 2)
+                break;
+            level = blake3::merge(level);
+        }
+        return bool(output.flush());
+    }
+
+    /**
+     * @brief Manifest of a file already written, hashed in parallel through a mapping.
+     *
+     * @param filePath file to hash.
+     * @param manifestPath manifest path.
+     * @return true if the file was read and the manifest written.
+     */
+    inline bool writeFor(const std::string &filePath, const std::string &manifestPath)
+    {
+        fileio::MappedFile file(filePath);
+        if (!file)
+            return false;
+
+        const size_t groups = (file.length() + GroupSize - 1) / GroupSize;
+        std::vector<blake3::ChainingValue> leaves(groups);
+        parallel::forChunks(
+            groups, [&](size_t begin, size_t end)
+            {
+                for (size_t group = begin; group < end; group++)
+                    leaves[group] = leaf(file.data() + group * GroupSize, std::min(GroupSize, file.length() - group * GroupSize), group);
+            },
+            std::max(1u, std::thread::hardware_concurrency()));
+
+        std::string rootHash;
+        if (groups <= 1)
+            rootHash = blake3::hash(file.data(), file.length());
+        else
+        {
+            std::vector<blake3::ChainingValue> level = leaves;
+            while (level.size() > 2)
+                level = blake3::merge(level);
+            rootHash = blake3::root(level[0], level[1]);
+        }
+        return write(manifestPath, file.length(), std::move(leaves), rootHash);
+    }
+
+    /**
+     * @brief Check a byte range of a file against its manifest: the leaves covering the range
+     * are rehashed and each is combined with the sibling nodes on its path up to the root.
+     * Only the range and O(log n) manifest records are read.
+     *
+     * @param filePath file to check.
+     * @param manifestPath manifest path.
+     * @param begin first byte offset.
+     * @param end byte offset past the range, clamped to the file size.
+     * @return true if the range matches the manifest and the manifest matches its root.
+     */
+    inline bool verifyRange(const std::string &filePath, const std::string &manifestPath, size_t begin, size_t end)
+    {
+        fileio::Descriptor file(filePath, O_RDONLY);
+        fileio::Descriptor manifest(manifestPath, O_RDONLY);
+        if (!file || !manifest)
+            return false;
+
+        // Header: three lines, the last being the root.
+        char head[256] = {};
+        const ssize_t headSize = ::pread(manifest.get(), head, sizeof(head) - 1, 0);
+        std::istringstream header(std::string(head, headSize > 0 ? size_t(headSize) : 0));
+        std::string magic, rootHex;
+        size_t size = 0, groupSize = 0, groups = 0;
+        if (!std::getline(header, magic) || magic != "sfe-merkle-manifest-1" || !(header >> size >> groupSize >> groups) ||
+            !(header >> rootHex) || groupSize != GroupSize || groups != (size + GroupSize - 1) / GroupSize ||
+            file.size() != off_t(size))
+            return false;
+        const size_t records = size_t(header.tellg()) + 1;
+
+        end = std::min(end, size);
+        if (begin >= end)
+            return begin == end;
+
+        const std::vector<size_t> sizes = levelSizes(groups);
+        const auto record = [&](size_t level, size_t index, blake3::ChainingValue &cv)
+        {
+            size_t position = records;
+            for (size_t i = 0; i < level; i++)
+                position += sizes[i] * RecordSize;
+            char hex[64];
+            if (!fileio::readAt(manifest.get(), hex, sizeof(hex), position + index * RecordSize))
+                return false;
+            for (int i = 0; i < 32; i++)
+            {
+                unsigned byte;
+                if (std::sscanf(hex + 2 * i, "%2x", &byte) != 1)
+                    return false;
+                cv[i / 4] = (i % 4 ? cv[i / 4] : 0) | std::uint32_t(byte) << (8 * (i % 4));
+            }
+            return true;
+        };
+
+        std::vector<char> buffer(std::min(GroupSize, size));
+        for (size_t group = begin / GroupSize; group <= (end - 1) / GroupSize; group++)
+        {
+            const size_t length = std::min(GroupSize, size - group * GroupSize);
+            if (!fileio::readAt(file.get(), buffer.data(), length, group * GroupSize))
+                return false;
+
+            if (groups == 1)
+                return toHex(blake3::hash(buffer.data(), length)) == rootHex;
+
+            blake3::ChainingValue node = leaf(buffer.data(), length, group), sibling;
+            size_t index = group;
+            for (size_t level = 0; level + 1 < sizes.size(); level++, index /= 2)
+            {
+                if ((index ^ 1) >= sizes[level])
+                    continue;
+                if (!record(level, index ^ 1, sibling))
+                    return false;
+                node = index % 2 ? blake3::parent(sibling, node) : blake3::parent(node, sibling);
+            }
+            if (!record(sizes.size() - 1, index ^ 1, sibling))
+                return false;
+            if (toHex(index ? blake3::root(sibling, node) : blake3::root(node, sibling)) != rootHex)
+                return false;
+        }
+        return true;
+    }
+}
+
+/** @brief Read-only byte range borrowed from a Source. */
+struct ByteSpan
+{
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+/**
+ * @brief A basic virtual class for where the bytes to transform come from.
+ *
+ * Chunks are borrowed: a source returns a pointer into memory it already holds (a mapping,
+ * a caller's buffer) or into its own read buffer, valid until the next call, and the
+ * pipeline transforms straight from there into the sink's buffer.
+ */
+class Source
+{
+public:
+    virtual ~Source() = default;
+
+    /**
+     * @brief Pure virtual method borrowing the next chunk.
+     * 
+     * @param chunk receives at most maxSize bytes, valid until the next call; empty at the end.
+     * @param maxSize largest chunk wanted.
+     * @return false on a read error.
+     */
+    virtual bool next(ByteSpan &chunk, size_t maxSize) = 0;
+};
+
+/**
+ * @brief A basic virtual class for where the transformed bytes go.
+ *
+ * The pipeline asks for a buffer, transforms into it and commits it, so sinks that own
+ * memory (a growing string, a buffer pool) receive the output without another copy.
+ */
+class Sink
+{
+public:
+    virtual ~Sink() = default;
+
+    /**
+     * @brief Pure virtual method lending a writable buffer.
+     * 
+     * @param size number of bytes the pipeline will write.
+     * @return buffer of at least size bytes, valid until commit().
+     */
+    virtual char *acquire(size_t size) = 0;
+
+    /**
+     * @brief Pure virtual method delivering the acquired buffer.
+     * 
+     * @param size number of bytes written into the buffer.
+     * @return false on a write error.
+     */
+    virtual bool commit(size_t size) = 0;
+
+    /**
+     * @brief Virtual method called once after the last chunk.
+     * 
+     * @return false on a write error.
+     */
+    virtual bool finish() { return true; }
+};
+
+/** @brief Concrete source reading a file descriptor (file, pipe or socket); the descriptor is not closed. */
+class FdSource : public Source
+{
+public:
+    /**
+     * @brief Construct the source.
+     * 
+     * @param fd descriptor to read.
+     */
+    explicit FdSource(int fd) : fd{fd} {}
+
+    bool next(ByteSpan &chunk, size_t maxSize) override
+    {
+        buffer.resize(maxSize);
+        ssize_t done;
+        do
+        {
+            done = ::read(fd, buffer.data(), maxSize);
+        } while (done < 0 && errno == EINTR);
+
+        chunk = {buffer.data(), done > 0 ? size_t(done) : 0};
+        return done >= 0;
+    }
+
+private:
+    int fd;
+    std::vector<char> buffer;
+};
+
+/** @brief Concrete source reading a file by path. */
+class FileSource : public Source
+{
+public:
+    /**
+     * @brief Open the file.
+     * 
+     * @param path path to the file.
+     */
+    explicit FileSource(const std::string &path) : file{path, O_RDONLY}, reader{file.get()} {}
+
+    /** @return true if the file was opened. */
+    explicit operator bool() const { return bool(file); }
+
+    bool next(ByteSpan &chunk, size_t maxSize) override
+    {
+        return file && reader.next(chunk, maxSize);
+    }
+
+private:
+    fileio::Descriptor file;
+    FdSource reader;
+};
+
+/** @brief Concrete source lending a memory-mapped file, without any read copy. */
+class MappedFileSource : public Source
+{
+public:
+    /**
+     * @brief Map the file.
+     * 
+     * @param path path to the file.
+     */
+    explicit MappedFileSource(const std::string &path) : file{path} {}
+
+    /** @return true if the file was mapped. */
+    explicit operator bool() const { return bool(file); }
+
+    bool next(ByteSpan &chunk, size_t maxSize) override
+    {
+        const size_t size = std::min(maxSize, file.length() - position);
+        chunk = {file.data() + position, size};
+        position += size;
+        return bool(file);
+    }
+
+private:
+    fileio::MappedFile file;
+    size_t position = 0;
+};
+
+/** @brief Concrete source lending a caller's memory span. */
+class MemorySource : public Source
+{
+public:
+    /**
+     * @brief Construct the source; the memory must outlive it.
+     * 
+     * @param data bytes.
+     * @param size number of bytes.
+     */
+    MemorySource(const char *data, size_t size) : data{data}, size{size} {}
+
+    /**
+     * @brief Construct the source over a string; the string must outlive it.
+     * 
+     * @param text bytes.
+     */
+    explicit MemorySource(const std::string &text) : MemorySource(text.data(), text.size()) {}
+
+    bool next(ByteSpan &chunk, size_t maxSize) override
+    {
+        const size_t length = std::min(maxSize, size - position);
+        chunk = {data + position, length};
+        position += length;
+        return true;
+    }
+
+private:
+    const char *data;
+    size_t size;
+    size_t position = 0;
+};
+
+/** @brief Concrete source pulling bytes from a callback. */
+class CallbackSource : public Source
+{
+public:
+    /** @brief Fills up to size bytes of the buffer; returns the count (0 at the end) or -1 on error. */
+    using Callback = std::function<long long(char *buffer, size_t size)>;
+
+    /**
+     * @brief Construct the source.
+     * 
+     * @param callback producer of the bytes.
+     */
+    explicit CallbackSource(Callback callback) : callback{std::move(callback)} {}
+
+    bool next(ByteSpan &chunk, size_t maxSize) override
+    {
+        buffer.resize(maxSize);
+        const long long done = callback(buffer.data(), maxSize);
+        chunk = {buffer.data(), done > 0 ? size_t(done) : 0};
+        return done >= 0;
+    }
+
+private:
+    Callback callback;
+    std::vector<char> buffer;
+};
+
+/** @brief Concrete sink writing to a file descriptor (file or pipe); the descriptor is not closed. */
+class FdSink : public Sink
+{
+public:
+    /**
+     * @brief Construct the sink.
+     * 
+     * @param fd descriptor to write.
+     */
+    explicit FdSink(int fd) : fd{fd} {}
+
+    char *acquire(size_t size) override
+    {
+        buffer.resize(std::max(buffer.size(), size));
+        return buffer.data();
+    }
+
+    bool commit(size_t size) override
+    {
+        return fileio::writeAll(fd, buffer.data(), size);
+    }
+
+protected:
+    int fd;
+    std::vector<char> buffer;
+};
+
+/** @brief Concrete sink writing a file by path (created or truncated). */
+class FileSink : public Sink
+{
+public:
+    /**
+     * @brief Open the file.
+     * 
+     * @param path path to the file.
+     */
+    explicit FileSink(const std::string &path) : file{path, O_WRONLY | O_CREAT | O_TRUNC}, writer{file.get()} {}
+
+    /** @return true if the file was opened. */
+    explicit operator bool() const { return bool(file); }
+
+    char *acquire(size_t size) override { return writer.acquire(size); }
+
+    bool commit(size_t size) override { return file && writer.commit(size); }
+
+private:
+    fileio::Descriptor file;
+    FdSink writer;
+};
+
+/** @brief Concrete sink writing to a connected socket, without SIGPIPE on a closed peer. */
+class SocketSink : public FdSink
+{
+public:
+    /**
+     * @brief Construct the sink.
+     * 
+     * @param socket connected stream socket; not closed.
+     */
+    explicit SocketSink(int socket) : FdSink{socket} {}
+
+    bool commit(size_t size) override
+    {
+        for (const char *data = buffer.data(); size;)
+        {
+            const ssize_t done = ::send(fd, data, size, MSG_NOSIGNAL);
+            if (done < 0 && errno == EINTR)
+                continue;
+            if (done <= 0)
+                return false;
+            data += done;
+            size -= size_t(done);
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Concrete sink sending to a connected TCP socket with MSG_ZEROCOPY.
+ *
+ * The kernel pins the pages of each buffer instead of copying them, so a buffer goes back to
+ * the pool only when its completion arrives on the socket error queue. Sockets without
+ * SO_ZEROCOPY (Unix sockets, other systems) fall back to plain sends from the same pool.
+ */
+class ZeroCopySocketSink : public Sink
+{
+public:
+    /**
+     * @brief Construct the sink and enable SO_ZEROCOPY if the socket supports it.
+     * 
+     * @param socket connected stream socket; not closed.
+     * @param buffers number of buffers that may be in flight.
+     */
+    explicit ZeroCopySocketSink(int socket, size_t buffers = 8) : fd{socket}, pool(std::max<size_t>(buffers, 1))
+    {
+#ifdef SFE_ZEROCOPY
+        const int one = 1;
+        zeroCopy = ::setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+#endif
+    }
+
+    ~ZeroCopySocketSink() override
+    {
+        while (pending() && reap(true))
+            ;
+    }
+
+    /** @return true if sends go through MSG_ZEROCOPY. */
+    bool usesZeroCopy() const { return zeroCopy; }
+
+    char *acquire(size_t size) override
+    {
+        current = nullptr;
+        while (!current)
+        {
+            for (Buffer &buffer : pool)
+                if (!buffer.busy)
+                {
+                    current = &buffer;
+                    break;
+                }
+            if (!current && !reap(true))
+                return dummy(size);
+        }
+        current->data.resize(std::max(current->data.size(), size));
+        return current->data.data();
+    }
+
+    bool commit(size_t size) override
+    {
+        if (!current || current->data.empty())
+            return false;
+
+        for (const char *data = current->data.data(); size;)
+        {
+            const ssize_t done = ::send(fd, data, size, MSG_NOSIGNAL | (zeroCopy ? MSG_ZEROCOPY : 0));
+            if (done < 0 && errno == EINTR)
+                continue;
+            // Out of pinned-memory budget: wait for the kernel to release earlier buffers.
+            if (done < 0 && errno == ENOBUFS && zeroCopy && pending())
+            {
+                if (!reap(true))
+                    return false;
+                continue;
+            }
+            if (done <= 0)
+                return false;
+
+            if (zeroCopy)
+            {
+                current->busy = true;
+                current->lastId = nextId++;
+            }
+            data += done;
+            size -= size_t(done);
+        }
+        reap(false);
+        return true;
+    }
+
+    bool finish() override
+    {
+        while (pending())
+            if (!reap(true))
+                return false;
+        return true;
+    }
+
+private:
+    /** @brief Pool buffer; busy until the completion of its last send. */
+    struct Buffer
+    {
+        std::vector<char> data;
+        uint32_t lastId = 0;
+        bool busy = false;
+    };
+
+    /** @return true if some buffer waits for a completion. */
+    bool pending() const
+    {
+        return std::any_of(pool.begin(), pool.end(), [](const Buffer &buffer) { return buffer.busy; });
+    }
+
+    /** @brief Scratch buffer handed out after a failure, so the pipeline stops at commit(). */
+    char *dummy(size_t size)
+    {
+        current = nullptr;
+        failed.resize(std::max(failed.size(), size));
+        return failed.data();
+    }
+
+    /**
+     * @brief Drain the completions on the socket error queue and release finished buffers.
+     * 
+     * @param wait block until at least one completion arrives.
+     * @return false on a socket error.
+     */
+    bool reap(bool wait)
+    {
+#ifdef SFE_ZEROCOPY
+        // Without SO_ZEROCOPY there are no completions, and some socket families would treat
+        // MSG_ERRQUEUE as an ordinary blocking receive.
+        if (!zeroCopy)
+            return true;
+
+        for (bool received = false;;)
+        {
+            char control[128];
+            msghdr message{};
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+
+            if (::recvmsg(fd, &message, MSG_ERRQUEUE) < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    return false;
+                if (received || !wait)
+                    return true;
+                // An error queue entry is signalled as POLLERR.
+                trace::Span span("wait completions");
+                pollfd events{fd, 0, 0};
+                if ((::poll(&events, 1, -1) < 0 && errno != EINTR) || (events.revents & POLLNVAL))
+                    return false;
+                continue;
+            }
+
+            for (cmsghdr *header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+            {
+                const auto *error = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(header));
+                if (error->ee_errno != 0 || error->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                    continue;
+
+                // Completions cover the inclusive id range [ee_info, ee_data]; ids wrap.
+                for (Buffer &buffer : pool)
+                    if (buffer.busy && uint32_t(buffer.lastId - error->ee_info) <= uint32_t(error->ee_data - error->ee_info))
+                        buffer.busy = false;
+                received = true;
+            }
+        }
+#else
+        (void)wait;
+        return true;
+#endif
+    }
+
+    int fd;
+    bool zeroCopy = false;
+    uint32_t nextId = 0;
+    std::vector<Buffer> pool;
+    Buffer *current = nullptr;
+    std::vector<char> failed;
+};
+
+/** @brief Concrete sink appending to a caller's string, transformed in place at its end. */
+class MemorySink : public Sink
+{
+public:
+    /**
+     * @brief Construct the sink; the string must outlive it.
+     * 
+     * @param output string receiving the bytes.
+     */
+    explicit MemorySink(std::string &output) : output{output} {}
+
+    char *acquire(size_t size) override
+    {
+        committed = output.size();
+        output.resize(committed + size);
+        return &output[committed];
+    }
+
+    bool commit(size_t size) override
+    {
+        output.resize(committed + size);
+        return true;
+    }
+
+private:
+    std::string &output;
+    size_t committed = 0;
+};
+
+/** @brief Concrete sink handing every chunk to a callback. */
+class CallbackSink : public Sink
+{
+public:
+    /** @brief Consumes size bytes; returns false to abort. */
+    using Callback = std::function<bool(const char *data, size_t size)>;
+
+    /**
+     * @brief Construct the sink.
+     * 
+     * @param callback consumer of the bytes.
+     */
+    explicit CallbackSink(Callback callback) : callback{std::move(callback)} {}
+
+    char *acquire(size_t size) override
+    {
+        buffer.resize(std::max(buffer.size(), size));
+        return buffer.data();
+    }
+
+    bool commit(size_t size) override { return callback(buffer.data(), size); }
+
+private:
+    Callback callback;
+    std::vector<char> buffer;
+};
+
+/** @brief Interface for file encryption using text encryption strategies. */
+class IFileEncryptor
+{
+public:
+    /** @brief One destination of a fan-out encryption. */
+    struct FanOutTarget
+    {
+        /** @brief Path to the file to which the encrypted text will be written. */
+        std::string filePathTo;
+
+        /** @brief Strategy to encrypt with. */
+        StrategyHandle strategy;
+
+        /** @brief Key string. */
+        std::string key;
+    };
+
+    /** @brief One file of a batch job. */
+    struct BatchJob
+    {
+        /** @brief Path to the file from which the text is taken. */
+        std::string filePathFrom;
+
+        /** @brief Path to the file to which the result will be written. */
+        std::string filePathTo;
+
+        /** @brief Key string. */
+        std::string key;
+    };
+
+    /**
+     * @brief Set the Strategy object.
+     * May be called while other threads run jobs: a job keeps the strategy it started
+     * with, and later jobs see the new one.
+     * 
+     * @param strat strategy object to encrypt/decrypt with.
+     */
+    void setStrategy(StrategyHandle strat)
+    {
+        if (strat)
+        {
+#ifdef __cpp_lib_atomic_shared_ptr
+            strategy.store(std::move(strat));
+#else
+            std::atomic_store(&strategy, std::move(strat));
+#endif
+        }
+    }
+
+    /**
+     * @brief Text files encryption method.
+     * 
+     * @param filePathFrom path to the file from which the text is taken for encryption.
+     * @param filePathTo path to the file to which the ecrypted text will be written.
+     * @param key key string, empty by default.
+     * @return true if the encryption strategy object was initialized earlier and false otherwise
+     * (or if a file could not be opened, for length-preserving strategies).
+     */
+    bool encrypt(const std::string &filePathFrom, const std::string &filePathTo, const std::string &key = "")
+    {
+        const StrategyHandle strategy = currentStrategy();
+        if (!strategy)
+            return false;
+
+        StrategyProbe probe(strategy.get(), StrategyProbe::Encrypt, key.size());
+        if (auto chunked = dynamic_cast<const LengthPreservingEncryptionStrategy *>(strategy.get()))
+        {
+            if (chunked->isIdentity(key))
+                return probe.finish(fileio::copyFile(filePathFrom, filePathTo));
+
+            const LengthPreservingEncryptionStrategy::Job job(*chunked, key, false);
+            return probe.finish(fileio::transformFile(filePathFrom, filePathTo, [&](char *buffer, size_t size, size_t offset)
+                                                      {
+                                                          job(buffer, buffer, size, offset);
+                                                          probe.add(size);
+                                                          return true;
+                                                      }));
+        }
+
+        const std::string text = getTextFromFile(filePathFrom);
+        std::ofstream output(filePathTo, std::ios::trunc);
+        output << strategy->encrypt(text, key);
+        probe.add(text.size());
+
+        return probe.finish(true);
+    }
+
+    /**
+     * @brief Text files decryption method.
+     * 
+     * @param filePathFrom path to the file from which the text is taken for decryption.
+     * @param filePathTo path to the file to which the decrypted text will be written.
+     * @param key key string, empty by default.
+     * @return true if the encryption strategy object was initialized earlier and false otherwise
+     * (or if a file could not be opened, for length-preserving strategies).
+     */
+    bool decrypt(const std::string &filePathFrom, const std::string &filePathTo, const std::string &key = "")
+    {
+        const StrategyHandle strategy = currentStrategy();
+        if (!strategy)
+            return false;
+
+        StrategyProbe probe(strategy.get(), StrategyProbe::Decrypt, key.size());
+        if (auto chunked = dynamic_cast<const LengthPreservingEncryptionStrategy *>(strategy.get()))
+        {
+            if (chunked->isIdentity(key))
+                return probe.finish(fileio::copyFile(filePathFrom, filePathTo));
+
+            const LengthPreservingEncryptionStrategy::Job job(*chunked, key, true);
+            return probe.finish(fileio::transformFile(filePathFrom, filePathTo, [&](char *buffer, size_t size, size_t offset)
+                                                      {
+                                                          job(buffer, buffer, size, offset);
+                                                          probe.add(size);
+                                                          return true;
+                                                      }));
+        }
+
+        const std::string text = getTextFromFile(filePathFrom);
+        std::ofstream output(filePathTo, std::ios::trunc);
+        output << strategy->decrypt(text, key);
+        probe.add(text.size());
+
+        return probe.finish(true);
+    }
+
+    /**
+     * @brief Stream encryption method between any source and sink, without intermediate files.
+     * 
+     * @param source where the text is taken from.
+     * @param sink where the encrypted text is written.
+     * @param key key string, empty by default.
+     * @return true if the encryption strategy object was initialized earlier and every chunk was
+     * read and written, false otherwise.
+     */
+    bool encrypt(Source &source, Sink &sink, const std::string &key = "")
+    {
+        return transformStream(source, sink, key, false);
+    }
+
+    /**
+     * @brief Stream decryption method between any source and sink, without intermediate files.
+     * 
+     * @param source where the encrypted text is taken from.
+     * @param sink where the decrypted text is written.
+     * @param key key string, empty by default.
+     * @return true if the encryption strategy object was initialized earlier and every chunk was
+     * read and written, false otherwise.
+     */
+    bool decrypt(Source &source, Sink &sink, const std::string &key = "")
+    {
+        return transformStream(source, sink, key, true);
+    }
+
+    /**
+     * @brief Passphrase encryption method: a master key is derived from the passphrase and the
+     * salt with PBKDF2-HMAC-SHA256 (cached, see kdf::deriveKey), the strategy key from it and a
+     * fresh per-file salt with HKDF-SHA256, and the output starts with a header recording both
+     * salts and the parameters.
+     * 
+     * @param filePathFrom path to the file from which the text is taken for encryption.
+     * @param filePathTo path to the container to which the header and the encrypted text will be written.
+     * @param passphrase passphrase.
+     * @param params salt (random if empty; share one to derive once for many files) and
+     * iteration count, from 1 to kdf::Header::MaxIterations.
+     * @return true if the encryption strategy object was initialized earlier, the iteration
+     * count is valid and the files were read and written, false otherwise.
+     */
+    bool encryptWithPassphrase(const std::string &filePathFrom, const std::string &filePathTo, const std::string &passphrase, kdf::Params params = {})
+    {
+        const StrategyHandle strategy = currentStrategy();
+        if (!strategy || params.iterations == 0 || params.iterations > kdf::Header::MaxIterations)
+            return false;
+
+        kdf::Header header;
+        header.params = std::move(params);
+        if (header.params.salt.empty())
+            header.params.salt = kdf::randomSalt();
+        header.fileSalt = kdf::randomSalt();
+
+        FileSource source(filePathFrom);
+        FileSink sink(filePathTo);
+        if (!source || !sink)
+            return false;
+
+        const std::string bytes = header.serialize();
+        std::memcpy(sink.acquire(bytes.size()), bytes.data(), bytes.size());
+        if (!sink.commit(bytes.size()))
+            return false;
+
+        return encrypt(source, sink, strategy->keyFromSecret(kdf::fileKey(passphrase, header)));
+    }
+
+    /**
+     * @brief Passphrase encryption of many files: one salt for the whole batch, so the
+     * passphrase is derived once and each file only costs its HKDF subkey.
+     * 
+     * @param jobs files to encrypt; the key members are not used.
+     * @param passphrase passphrase.
+     * @param params iteration count and batch salt (random if empty).
+     * @return true if every file was encrypted.
+     */
+    bool encryptBatchWithPassphrase(const std::vector<BatchJob> &jobs, const std::string &passphrase, kdf::Params params = {})
+    {
+        if (params.salt.empty())
+            params.salt = kdf::randomSalt();
+
+        bool ok = true;
+        for (const auto &job : jobs)
+        {
+            ok &= encryptWithPassphrase(job.filePathFrom, job.filePathTo, passphrase, params);
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Passphrase decryption method for containers written by encryptWithPassphrase().
+     * 
+     * @param filePathFrom path to the container.
+     * @param filePathTo path to the file to which the decrypted text will be written.
+     * @param passphrase passphrase.
+     * @return true if the encryption strategy object was initialized earlier, the container
+     * header is valid and the files were read and written, false otherwise.
+     */
+    bool decryptWithPassphrase(const std::string &filePathFrom, const std::string &filePathTo, const std::string &passphrase)
+    {
+        const StrategyHandle strategy = currentStrategy();
+        fileio::Descriptor input(filePathFrom, O_RDONLY);
+        kdf::Header header;
+        size_t headerSize = 0;
+        if (!strategy || !input || !header.read(input.get(), headerSize) || ::lseek(input.get(), off_t(headerSize), SEEK_SET) < 0)
+            return false;
+
+        FdSource source(input.get());
+        FileSink sink(filePathTo);
+        return sink && decrypt(source, sink, strategy->keyFromSecret(kdf::fileKey(passphrase, header)));
+    }
+
+    /**
+     * @brief Passphrase decryption of many containers in one process; containers of one
+     * batch share their salt, so the passphrase is derived once (see kdf::deriveKey).
+     * 
+     * @param jobs containers to decrypt; the key members are not used.
+     * @param passphrase passphrase.
+     * @return true if every container was decrypted.
+     */
+    bool decryptBatchWithPassphrase(const std::vector<BatchJob> &jobs, const std::string &passphrase)
+    {
+        bool ok = true;
+        for (const auto &job : jobs)
+        {
+            ok &= decryptWithPassphrase(job.filePathFrom, job.filePathTo, passphrase);
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Text files re-keying method: re-encrypt a file from oldKey to newKey in one pass,
+     * without writing the plaintext anywhere.
+     * 
+     * @param filePathFrom path to the file encrypted with oldKey.
+     * @param filePathTo path to the file to which the text encrypted with newKey will be written.
+     * @param oldKey current key string.
+     * @param newKey new key string.
+     * @return true if the encryption strategy object was initialized earlier and false otherwise
+     * (or if a file could not be opened, for length-preserving strategies).
+     */
+    bool rekey(const std::string &filePathFrom, const std::string &filePathTo, const std::string &oldKey, const std::string &newKey)
+    {
+        const StrategyHandle strategy = currentStrategy();
+        if (!strategy)
+            return false;
+
+        StrategyProbe probe(strategy.get(), StrategyProbe::Rekey, newKey.size());
+        if (auto chunked = dynamic_cast<const LengthPreservingEncryptionStrategy *>(strategy.get()))
+        {
+            if (chunked->isIdentityRekey(oldKey, newKey))
+                return probe.finish(fileio::copyFile(filePathFrom, filePathTo));
+
+            const LengthPreservingEncryptionStrategy::Job job(*chunked, oldKey, newKey);
+            return probe.finish(fileio::transformFile(filePathFrom, filePathTo, [&](char *buffer, size_t size, size_t offset)
+                                                      {
+                                                          job(buffer, buffer, size, offset);
+                                                          probe.add(size);
+                                                          return true;
+                                                      }));
+        }
+
+        const std::string text = getTextFromFile(filePathFrom);
+        std::ofstream output(filePathTo, std::ios::trunc);
+        output << strategy->rekey(text, oldKey, newKey);
+        probe.add(text.size());
+
+        return probe.finish(true);
+    }
+
+    /**
+     * @brief Search for plaintext inside an encrypted file without decrypting it.
+     * The needle is encrypted at every key phase and the memory-mapped ciphertext is
+     * scanned for those variants in parallel; nothing decrypted is written. When the
+     * variants would take more than MaxSearchPatternsSize (long keys), chunks are decrypted
+     * in memory and scanned instead.
+     * 
+     * @param filePath path to the encrypted file.
+     * @param needle plaintext to find, non-empty.
+     * @param key key string the file was encrypted with.
+     * @param matches receives the offsets of every (possibly overlapping) occurrence, in increasing order.
+     * @return true if the search ran, false if no strategy was set, the strategy has no
+     * key period (see LengthPreservingEncryptionStrategy::keyPeriod), the needle is empty
+     * or the file could not be mapped.
+     */
+    bool encryptedSearch(const std::string &filePath, const std::string &needle, const std::string &key, std::vector<size_t> &matches)
+    {
+        matches.clear();
+        const StrategyHandle strategy = currentStrategy();
+        auto chunked = dynamic_cast<const LengthPreservingEncryptionStrategy *>(strategy.get());
+        const size_t period = chunked ? chunked->keyPeriod(key) : 0;
+        if (!period || needle.empty())
+            return false;
+
+        fileio::MappedFile file(filePath);
+        if (!file)
+            return false;
+
+        std::mutex found;
+        std::map<size_t, std::vector<size_t>> ranges;
+        if (period <= MaxSearchPatternsSize / needle.size())
+        {
+            std::string patterns(period * needle.size(), '\0');
+            const LengthPreservingEncryptionStrategy::Job job(*chunked, key, false);
+            for (size_t phase = 0; phase < period; phase++)
+            {
+                job(needle.data(), &patterns[phase * needle.size()], needle.size(), phase);
+            }
+            const kernels::PhasedNeedleScanner scanner(std::move(patterns), needle.size(), period);
+
+            parallel::forChunks(file.length(), [&](size_t begin, size_t end)
+                                {
+                                    std::vector<size_t> rangeMatches;
+                                    scanner.scan(file.data(), file.length(), begin, end, rangeMatches);
+                                    std::lock_guard<std::mutex> lock(found);
+                                    ranges[begin] = std::move(rangeMatches);
+                                });
+        }
+        else
+        {
+            const LengthPreservingEncryptionStrategy::Job job(*chunked, key, true);
+            parallel::forChunks(file.length(), [&](size_t begin, size_t end)
+                                {
+                                    std::vector<size_t> rangeMatches;
+                                    std::string window;
+                                    // Each window also covers the needle's overhang into the next one.
+                                    for (size_t offset = begin; offset < end; offset += fileio::ChunkSize)
+                                    {
+                                        const size_t starts = std::min(fileio::ChunkSize, end - offset);
+                                        window.resize(std::min(starts + needle.size() - 1, file.length() - offset));
+                                        job(file.data() + offset, &window[0], window.size(), offset);
+                                        for (size_t at = window.find(needle); at != std::string::npos && at < starts; at = window.find(needle, at + 1))
+                                        {
+                                            rangeMatches.push_back(offset + at);
+                                        }
+                                    }
+                                    std::lock_guard<std::mutex> lock(found);
+                                    ranges[begin] = std::move(rangeMatches);
+                                });
+        }
+
+        for (const auto &range : ranges)
+        {
+            matches.insert(matches.end(), range.second.begin(), range.second.end());
+        }
+        return true;
+    }
+
+    /**
+     * @brief Round-trip verification: decrypt the encrypted file chunk by chunk in memory and
+     * compare it with the original, in parallel ranges. No plaintext is written anywhere.
+     * 
+     * @param filePathOriginal path to the original file.
+     * @param filePathEncrypted path to the encrypted file.
+     * @param key key string the file was encrypted with.
+     * @param mismatch receives the offset of the first byte where the decryption differs from
+     * the original (the shorter length if one is a prefix of the other), or -1 if they match.
+     * @return true if the comparison ran, false if no strategy was set or a file could not be
+     * opened or read.
+     */
+    bool verify(const std::string &filePathOriginal, const std::string &filePathEncrypted, const std::string &key, long long &mismatch)
+    {
+        mismatch = -1;
+        const StrategyHandle strategy = currentStrategy();
+        if (!strategy)
+            return false;
+
+        fileio::Descriptor original(filePathOriginal, O_RDONLY);
+        fileio::Descriptor encrypted(filePathEncrypted, O_RDONLY);
+        const off_t originalSize = original ? original.size() : -1;
+        const off_t encryptedSize = encrypted ? encrypted.size() : -1;
+        if (originalSize < 0 || encryptedSize < 0)
+            return false;
+
+        auto chunked = dynamic_cast<const LengthPreservingEncryptionStrategy *>(strategy.get());
+        if (!chunked)
+            return verifyBlocks(*strategy, original, size_t(originalSize), encrypted, size_t(encryptedSize), key, mismatch);
+
+        const size_t common = size_t(std::min(originalSize, encryptedSize));
+        std::atomic<size_t> first{common};
+        std::atomic<bool> ok{true};
+        const LengthPreservingEncryptionStrategy::Job job(*chunked, key, true);
+        parallel::forChunks(common, [&](size_t begin, size_t end)
+                            {
+                                std::vector<char> expected(std::min(fileio::ChunkSize, end - begin)), decrypted(expected.size());
+                                // Ranges past an earlier mismatch need not be compared.
+                                for (size_t offset = begin; offset < end && offset < first.load(std::memory_order_relaxed); offset += expected.size())
+                                {
+                                    const size_t size = std::min(expected.size(), end - offset);
+                                    if (!fileio::readAt(original.get(), expected.data(), size, offset) ||
+                                        !fileio::readAt(encrypted.get(), decrypted.data(), size, offset))
+                                    {
+                                        ok = false;
+                                        return;
+                                    }
+                                    job(decrypted.data(), decrypted.data(), size, offset);
+
+                                    const size_t index = kernels::firstDifference(expected.data(), decrypted.data(), size);
+                                    if (index < size)
+                                    {
+                                        size_t current = first.load();
+                                        while (offset + index < current && !first.compare_exchange_weak(current, offset + index))
+                                            ;
+                                        return;
+                                    }
+                                }
+                            });
+
+        if (first < common || originalSize != encryptedSize)
+            mismatch = static_cast<long long>(first.load());
+        return ok;
+    }
+
+    /**
+     * @brief Text file encryption that also writes a tree-hash manifest of the encrypted file
+     * (see merkle). For length-preserving strategies each 1 MiB leaf is read, encrypted, hashed
+     * while in cache and written, all leaves in parallel; other strategies hash the output in a
+     * second pass.
+     * 
+     * @param filePathFrom path to the file from which the text is taken for encryption.
+     * @param filePathTo path to the file to which the encrypted text will be written.
+     * @param key key string.
+     * @param manifestPath manifest path, filePathTo + ".merkle" if empty.
+     * @return true if the file and the manifest were written, false if no strategy was set or
+     * a file could not be opened, read or written.
+     */
+    bool encryptWithManifest(const std::string &filePathFrom, const std::string &filePathTo, const std::string &key, std::string manifestPath = "")
+    {
+        if (manifestPath.empty())
+            manifestPath = filePathTo + ".merkle";
+
+        const StrategyHandle strategy = currentStrategy();
+        if (!strategy)
+            return false;
+
+        auto chunked = dynamic_cast<const LengthPreservingEncryptionStrategy *>(strategy.get());
+        if (!chunked)
+            return encrypt(filePathFrom, filePathTo, key) && merkle::writeFor(filePathTo, manifestPath);
+
+        StrategyProbe probe(strategy.get(), StrategyProbe::Encrypt, key.size());
+        fileio::Descriptor input(filePathFrom, O_RDONLY);
+        const off_t size = input ? input.size() : -1;
+        fileio::Descriptor output(filePathTo, O_WRONLY | O_CREAT | O_TRUNC);
+        if (!output || size < 0)
+            return probe.finish(false);
+        fileio::preallocate(output.get(), size_t(size));
+        if (::ftruncate(output.get(), size) != 0)
+            return probe.finish(false);
+
+        const size_t groups = (size_t(size) + merkle::GroupSize - 1) / merkle::GroupSize;
+        std::vector<blake3::ChainingValue> leaves(groups);
+        std::string rootHash = blake3::hash(nullptr, 0);
+        std::atomic<bool> ok{true};
+        const LengthPreservingEncryptionStrategy::Job job(*chunked, key, false);
+        parallel::forChunks(
+            groups, [&](size_t begin, size_t end)
+            {
+                std::vector<char> buffer(std::min(merkle::GroupSize, size_t(size)));
+                for (size_t group = begin; group < end && ok; group++)
+                {
+                    const size_t offset = group * merkle::GroupSize;
+                    const size_t length = std::min(merkle::GroupSize, size_t(size) - offset);
+                    if (!fileio::readAt(input.get(), buffer.data(), length, offset))
+                    {
+                        ok = false;
+                        return;
+                    }
+                    job(buffer.data(), buffer.data(), length, offset);
+                    leaves[group] = merkle::leaf(buffer.data(), length, group);
+                    if (groups == 1)
+                        rootHash = blake3::hash(buffer.data(), length);
+                    if (!fileio::writeAt(output.get(), buffer.data(), length, offset))
+                    {
+                        ok = false;
+                        return;
+                    }
+                    probe.add(length);
+                }
+            },
+            std::max(1u, std::thread::hardware_concurrency()));
+        if (!ok)
+            return probe.finish(false);
+
+        if (groups > 1)
+        {
+            std::vector<blake3::ChainingValue> level = leaves;
+            while (level.size() > 2)
+                level = blake3::merge(level);
+            rootHash = blake3::root(level[0], level[1]);
+        }
+        return probe.finish(merkle::write(manifestPath, size_t(size), std::move(leaves), rootHash));
+    }
+
+    /**
+     * @brief Text files encryption under several strategy/key pairs with a single read of the source.
+     * Each chunk is read once and, while it is hot in cache, encrypted into every destination;
+     * workers write their ranges of all destinations in parallel. Does not use the strategy object.
+     * Destinations whose strategy is not length-preserving get the whole text instead, read once
+     * for all of them; the others still take the chunked path.
+     * 
+     * @param filePathFrom path to the file from which the text is taken for encryption.
+     * @param targets destinations with their strategies and keys.
+     * @return true if every destination was written, false if a strategy is missing or a file
+     * could not be opened, read or written.
+     */
+    bool encryptFanOut(const std::string &filePathFrom, const std::vector<FanOutTarget> &targets)
+    {
+        std::vector<const LengthPreservingEncryptionStrategy *> chunked;
+        for (const auto &target : targets)
+        {
+            if (!target.strategy)
+                return false;
+            chunked.push_back(dynamic_cast<const LengthPreservingEncryptionStrategy *>(target.strategy.get()));
+        }
+
+        fileio::Descriptor input(filePathFrom, O_RDONLY);
+        const off_t size = input ? input.size() : -1;
+        if (size < 0)
+            return false;
+
+        bool ok = true;
+        if (std::find(chunked.begin(), chunked.end(), nullptr) != chunked.end())
+        {
+            std::string text(size_t(size), '\0');
+            if (!fileio::readAt(input.get(), &text[0], text.size(), 0))
+                return false;
+            for (size_t i = 0; i < targets.size(); i++)
+            {
+                if (chunked[i])
+                    continue;
+                std::ofstream output(targets[i].filePathTo, std::ios::trunc);
+                output << targets[i].strategy->encrypt(text, targets[i].key);
+                ok &= bool(output.flush());
+            }
+        }
+
+        std::vector<std::unique_ptr<fileio::Descriptor>> outputs;
+        std::vector<LengthPreservingEncryptionStrategy::Job> jobs;
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            if (!chunked[i])
+                continue;
+            outputs.emplace_back(new fileio::Descriptor(targets[i].filePathTo, O_WRONLY | O_CREAT | O_TRUNC));
+            if (!*outputs.back() || ::ftruncate(outputs.back()->get(), size) != 0)
+                return false;
+            jobs.emplace_back(*chunked[i], targets[i].key, false);
+        }
+        if (jobs.empty())
+            return ok;
+
+        std::atomic<bool> written{true};
+        parallel::forChunks(size_t(size), [&](size_t begin, size_t end)
+                            {
+                                std::vector<char> in(std::min(fileio::ChunkSize, end - begin)), out(in.size());
+                                for (size_t offset = begin; offset < end && written; offset += in.size())
+                                {
+                                    const size_t chunk = std::min(in.size(), end - offset);
+                                    if (!fileio::readAt(input.get(), in.data(), chunk, offset))
+                                    {
+                                        written = false;
+                                        break;
+                                    }
+                                    for (size_t i = 0; i < jobs.size(); i++)
+                                    {
+                                        jobs[i](in.data(), out.data(), chunk, offset);
+                                        if (!fileio::writeAt(outputs[i]->get(), out.data(), chunk, offset))
+                                            written = false;
+                                    }
+                                }
+                            });
+        return ok && written;
+    }
+
+    /**
+     * @brief Batch encryption method: files are read in the order of their physical location
+     * (FIEMAP), one at a time and front to back, and each output is preallocated at its
+     * final size.
+     * 
+     * @param jobs files to encrypt.
+     * @return true if the encryption strategy object was initialized earlier and every job
+     * succeeded, false otherwise (the remaining jobs still run).
+     */
+    bool encryptBatch(const std::vector<BatchJob> &jobs)
+    {
+        return transformBatch(jobs, false);
+    }
+
+    /**
+     * @brief Batch decryption method, in the same order and with the same preallocation as
+     * encryptBatch().
+     * 
+     * @param jobs files to decrypt.
+     * @return true if the encryption strategy object was initialized earlier and every job
+     * succeeded, false otherwise (the remaining jobs still run).
+     */
+    bool decryptBatch(const std::vector<BatchJob> &jobs)
+    {
+        return transformBatch(jobs, true);
+    }
+
+    /**
+     * @brief One-time pad encryption/decryption: XOR a file with a key file of at least the same size.
+     * Data and pad are streamed in lockstep, chunk by chunk in parallel, never loaded whole.
+     * Does not use the strategy object.
+     * 
+     * @param filePathFrom path to the file to encrypt or decrypt.
+     * @param filePathTo path to the file to which the result will be written.
+     * @param keyFilePath path to the pad file.
+     * @return true on success, false if a file could not be opened or the pad is shorter than the data.
+     */
+    bool xorWithKeyFile(const std::string &filePathFrom, const std::string &filePathTo, const std::string &keyFilePath)
+    {
+        fileio::Descriptor pad(keyFilePath, O_RDONLY);
+        fileio::Descriptor input(filePathFrom, O_RDONLY);
+        if (!pad || !input || pad.size() < input.size())
+            return false;
+
+        return fileio::transformFile(filePathFrom, filePathTo, [&](char *buffer, size_t size, size_t offset)
+                                     {
+                                         thread_local std::vector<char> padChunk;
+                                         padChunk.resize(size);
+                                         if (!fileio::readAt(pad.get(), padChunk.data(), size, offset))
+                                             return false;
+                                         kernels::xorStreams(buffer, padChunk.data(), buffer, size);
+                                         return true;
+                                     });
+    }
+
+private:
+    /** @brief Largest encrypted-needle table of encryptedSearch (needle size times key period). */
+    static constexpr size_t MaxSearchPatternsSize = size_t(16) << 20;
+
+    /** @brief Text encryption strategy object, swapped atomically. */
+#ifdef __cpp_lib_atomic_shared_ptr
+    std::atomic<StrategyHandle> strategy;
+#else
+    StrategyHandle strategy;
+#endif
+
+    /**
+     * @brief Snapshot of the strategy for one job; taken once per job, never per chunk.
+     * 
+     * @return current strategy, or nullptr if none was set.
+     */
+    StrategyHandle currentStrategy() const
+    {
+#ifdef __cpp_lib_atomic_shared_ptr
+        return strategy.load();
+#else
+        return std::atomic_load(&strategy);
+#endif
+    }
+
+    /**
+     * @brief Run a batch in physical order. A file is transformed by one thread from front to
+     * back, since parallel ranges of one file would make a rotating disk seek between them.
+     */
+    bool transformBatch(const std::vector<BatchJob> &jobs, bool decrypting)
+    {
+        const StrategyHandle strategy = currentStrategy();
+        if (!strategy)
+            return false;
+
+        auto chunked = dynamic_cast<const LengthPreservingEncryptionStrategy *>(strategy.get());
+        std::vector<std::string> inputs;
+        for (const auto &job : jobs)
+        {
+            inputs.push_back(job.filePathFrom);
+        }
+
+        bool ok = true;
+        for (const size_t index : fileio::physicalOrder(inputs))
+        {
+            const BatchJob &job = jobs[index];
+            trace::Span span("batch job");
+            StrategyProbe probe(strategy.get(), decrypting ? StrategyProbe::Decrypt : StrategyProbe::Encrypt, job.key.size());
+            fileio::Descriptor input(job.filePathFrom, O_RDONLY);
+            const off_t size = input ? input.size() : -1;
+            fileio::Descriptor output(job.filePathTo, O_WRONLY | O_CREAT | O_TRUNC);
+            if (size < 0 || !output)
+            {
+                ok = false;
+                continue;
+            }
+
+            const long long outputSize = strategy->outputSize(size_t(size), decrypting);
+            if (outputSize > 0)
+            {
+                fileio::preallocate(output.get(), size_t(outputSize));
+            }
+
+            if (chunked)
+            {
+                const LengthPreservingEncryptionStrategy::Job transform(*chunked, job.key, decrypting);
+                ok &= probe.finish(fileio::transformRange(input.get(), output.get(), 0, size_t(size), [&](char *buffer, size_t length, size_t offset)
+                                                          {
+                                                              transform(buffer, buffer, length, offset);
+                                                              probe.add(length);
+                                                              return true;
+                                                          }));
+                continue;
+            }
+
+            const std::string text = getTextFromFile(job.filePathFrom);
+            const std::string result = decrypting ? strategy->decrypt(text, job.key) : strategy->encrypt(text, job.key);
+            probe.add(text.size());
+            // Drop blocks preallocated beyond the actual output.
+            ok &= probe.finish(fileio::writeAll(output.get(), result.data(), result.size()) && ::ftruncate(output.get(), off_t(result.size())) == 0);
+        }
+        return ok;
+    }
+
+    /**
+     * @brief Move every chunk of the source through the strategy into the sink.
+     * Length-preserving strategies transform each borrowed source chunk directly into the
+     * sink's buffer; block-wise ones (Binary) transform the whole blocks of each chunk, at most
+     * a chunk of output at a time, carrying a partial block over; other strategies need the
+     * whole text, gathered once.
+     */
+    bool transformStream(Source &source, Sink &sink, const std::string &key, bool decrypting)
+    {
+        const StrategyHandle strategy = currentStrategy();
+        if (!strategy)
+            return false;
+
+        StrategyProbe probe(strategy.get(), decrypting ? StrategyProbe::Decrypt : StrategyProbe::Encrypt, key.size());
+        auto chunked = dynamic_cast<const LengthPreservingEncryptionStrategy *>(strategy.get());
+        const size_t block = chunked ? 0 : strategy->blockSize(decrypting);
+        // Expanding block strategies read less, so each step writes about a chunk.
+        const size_t unit = std::max<size_t>(1, block);
+        const size_t expansion = block ? std::max<size_t>(1, size_t(strategy->outputSize(block, decrypting)) / block) : 1;
+        const size_t readSize = std::max(unit, fileio::ChunkSize / expansion / unit * unit);
+        std::unique_ptr<const LengthPreservingEncryptionStrategy::Job> job;
+        if (chunked)
+        {
+            job = std::make_unique<const LengthPreservingEncryptionStrategy::Job>(*chunked, key, decrypting);
+        }
+        std::string text;
+        size_t offset = 0;
+
+        // Transform size bytes (whole blocks, or any bytes for length-preserving strategies) into the sink.
+        const auto emit = [&](const char *in, size_t size)
+        {
+            const size_t outputSize = chunked ? size : size_t(strategy->outputSize(size, decrypting));
+            char *out;
+            {
+                trace::Span span("acquire buffer", outputSize);
+                out = sink.acquire(outputSize);
+            }
+            {
+                trace::Span span("transform", size);
+                SFE_PROBE(chunk__dispatch, offset, size);
+                if (!chunked)
+                    strategy->transformBlocks(in, size, out, key, decrypting);
+                else
+                    (*job)(in, out, size, offset);
+                SFE_PROBE(chunk__complete, offset, size, true);
+                probe.add(size);
+            }
+            trace::Span span("write", outputSize);
+            SFE_PROBE(io__submit, -1, offset, outputSize, 1);
+            const bool written = sink.commit(outputSize);
+            SFE_PROBE(io__complete, -1, offset, outputSize, 1, written);
+            offset += size;
+            return written;
+        };
+
+        for (ByteSpan chunk;;)
+        {
+            {
+                trace::Span span("read");
+                if (!source.next(chunk, readSize))
+                    return false;
+            }
+            if (!chunk.size)
+                break;
+
+            if (chunked)
+            {
+                if (!emit(chunk.data, chunk.size))
+                    return false;
+                continue;
+            }
+            if (!block)
+            {
+                text.append(chunk.data, chunk.size);
+                continue;
+            }
+
+            // Complete a block split across chunks, then the whole blocks, then keep the rest.
+            const char *data = chunk.data;
+            size_t size = chunk.size;
+            if (!text.empty())
+            {
+                const size_t take = std::min(block - text.size(), size);
+                text.append(data, take);
+                data += take;
+                size -= take;
+                if (text.size() == block)
+                {
+                    if (!emit(text.data(), block))
+                        return false;
+                    text.clear();
+                }
+            }
+            const size_t whole = size / block * block;
+            if (whole && !emit(data, whole))
+                return false;
+            text.assign(data + whole, size - whole);
+        }
+
+        if (block)
+        {
+            // A trailing partial block is not valid input.
+            return probe.finish(text.empty() && sink.finish());
+        }
+        if (!chunked)
+        {
+            const std::string output = decrypting ? strategy->decrypt(text, key) : strategy->encrypt(text, key);
+            probe.add(text.size());
+            if (!output.empty())
+            {
+                std::memcpy(sink.acquire(output.size()), output.data(), output.size());
+                if (!sink.commit(output.size()))
+                    return false;
+            }
+        }
+        return probe.finish(sink.finish());
+    }
+
+    /**
+     * @brief verify() for strategies that do not preserve the length. Block-wise ones
+     * (Binary) decrypt the whole blocks of the encrypted file range by range, in parallel,
+     * and compare each range with the matching range of the original; other strategies need
+     * both texts whole.
+     * 
+     * @return true if the comparison ran, false if a file could not be read.
+     */
+    bool verifyBlocks(const EncryptionStrategy &strategy, const fileio::Descriptor &original, size_t originalSize,
+                      const fileio::Descriptor &encrypted, size_t encryptedSize, const std::string &key, long long &mismatch)
+    {
+        const size_t block = strategy.blockSize(true);
+        if (!block)
+        {
+            std::string originalText(originalSize, '\0'), encryptedText(encryptedSize, '\0');
+            if (!fileio::readAt(original.get(), &originalText[0], originalSize, 0) ||
+                !fileio::readAt(encrypted.get(), &encryptedText[0], encryptedSize, 0))
+                return false;
+            const std::string decrypted = strategy.decrypt(encryptedText, key);
+            const size_t common = std::min(originalText.size(), decrypted.size());
+            const size_t first = kernels::firstDifference(originalText.data(), decrypted.data(), common);
+            if (first < common || originalText.size() != decrypted.size())
+                mismatch = static_cast<long long>(first);
+            return true;
+        }
+
+        // Compare the blocks both files have; a trailing partial block decrypts to nothing.
+        const size_t plain = size_t(strategy.outputSize(block, true));
+        const size_t decryptedSize = encryptedSize / block * plain;
+        const size_t blocks = std::min(originalSize / plain, encryptedSize / block);
+        const size_t stepBlocks = std::max<size_t>(1, fileio::ChunkSize / block);
+        std::atomic<size_t> first{blocks * plain};
+        std::atomic<bool> ok{true};
+        parallel::forChunks(blocks, [&](size_t begin, size_t end)
+                            {
+                                std::vector<char> input(std::min(stepBlocks, end - begin) * block), expected(input.size() / block * plain), decrypted(expected.size());
+                                // Ranges past an earlier mismatch need not be compared.
+                                for (size_t index = begin; index < end && index * plain < first.load(std::memory_order_relaxed); index += stepBlocks)
+                                {
+                                    const size_t count = std::min(stepBlocks, end - index);
+                                    if (!fileio::readAt(encrypted.get(), input.data(), count * block, index * block) ||
+                                        !fileio::readAt(original.get(), expected.data(), count * plain, index * plain))
+                                    {
+                                        ok = false;
+                                        return;
+                                    }
+                                    strategy.transformBlocks(input.data(), count * block, decrypted.data(), key, true);
+
+                                    const size_t difference = kernels::firstDifference(expected.data(), decrypted.data(), count * plain);
+                                    if (difference < count * plain)
+                                    {
+                                        size_t current = first.load();
+                                        while (index * plain + difference < current && !first.compare_exchange_weak(current, index * plain + difference))
+                                            ;
+                                        return;
+                                    }
+                                }
+                            });
+
+        if (first < blocks * plain || originalSize != decryptedSize || encryptedSize % block)
+            mismatch = static_cast<long long>(first.load());
+        return ok;
+    }
+
+    /**
+     * @brief Get the text from file object.
+     * 
+     * @param filePath path to text file.
+     * @return std::string (text from file).
+     */
+    std::string getTextFromFile(const std::string &filePath)
+    {
+        return std::string(
+            (std::istreambuf_iterator<char>(
+                *(std::unique_ptr<std::ifstream>(
+                      new std::ifstream(filePath)))
+                     .get())),
+            std::istreambuf_iterator<char>());
+    }
+};
+
+/**
+ * @brief Encryption of one huge file by several worker processes, each owning a byte range.
+ *
+ * The coordinator sizes the output, spawns one worker per range (this binary in
+ * --shard-worker mode, which can equally be started on another host sharing the
+ * filesystem), and merges the per-range manifest parts into a final manifest.
+ * Each worker pwrites only its own range and starts at the key phase of the range
+ * offset, so workers never coordinate. Only length-preserving strategies can be sharded.
+ */
+class ShardedFileEncryptor
+{
+public:
+    /** @brief Worker processes allowed per hardware thread; more only add fork and page-cache contention. */
+    static constexpr size_t MaxWorkersPerThread = 4;
+
+    /**
+     * @brief Look up a length-preserving strategy by name.
+     * 
+     * @param name registered strategy name.
+     * @return shared strategy object, or nullptr for an unknown or non-length-preserving strategy.
+     */
+    static std::shared_ptr<const LengthPreservingEncryptionStrategy> findChunkedStrategy(const std::string &name)
+    {
+        return std::dynamic_pointer_cast<const LengthPreservingEncryptionStrategy>(findStrategy(name));
+    }
+
+    /**
+     * @brief Encrypt or decrypt a file with local worker processes and write the manifest.
+     * 
+     * @param executable path to this binary, run in --shard-worker mode.
+     * @param strategyName length-preserving strategy name.
+     * @param decrypt decrypt instead of encrypt.
+     * @param filePathFrom input path.
+     * @param filePathTo output path; the manifest is written to filePathTo + ".manifest".
+     * @param key key string, passed to the workers on stdin.
+     * @param workers number of worker processes (byte ranges), at most MaxWorkersPerThread per
+     * hardware thread and one per byte.
+     * @return true if every range was written and the manifest covers the whole file.
+     */
+    static bool run(const std::string &executable, const std::string &strategyName, bool decrypt,
+                    const std::string &filePathFrom, const std::string &filePathTo, const std::string &key, size_t workers)
+    {
+        fileio::Descriptor input(filePathFrom, O_RDONLY);
+        if (!input || !findChunkedStrategy(strategyName) || !workers)
+            return false;
+
+        const size_t size = size_t(input.size());
+        workers = std::min(workers, MaxWorkersPerThread * std::max(1u, std::thread::hardware_concurrency()));
+        {
+            fileio::Descriptor output(filePathTo, O_WRONLY | O_CREAT | O_TRUNC);
+            if (!output || ::ftruncate(output.get(), off_t(size)) != 0)
+                return false;
+        }
+
+        const size_t rangeSize = std::max<size_t>(1, (size + workers - 1) / workers);
+        std::vector<pid_t> children;
+        size_t shards = 0;
+        bool ok = true;
+
+        for (size_t begin = 0; begin < size || shards == 0; begin += rangeSize, shards++)
+        {
+            const size_t end = std::min(size, begin + rangeSize);
+            const std::vector<std::string> arguments{
+                executable, "--shard-worker", strategyName, decrypt ? "decrypt" : "encrypt",
+                filePathFrom, filePathTo, std::to_string(begin), std::to_string(end), partPath(filePathTo, shards)};
+
+            const pid_t child = spawnWithInput(arguments, key);
+            if (child < 0)
+            {
+                ok = false;
+                break;
+            }
+            children.push_back(child);
+        }
+
+        for (const auto &child : children)
+        {
+            int status = 0;
+            if (::waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            {
+                ok = false;
+            }
+        }
+
+        return mergeManifest(filePathTo, size, shards) && ok;
+    }
+
+    /**
+     * @brief Worker side: transform one byte range in place in the shared output and
+     * write its manifest part ("begin end hash").
+     * 
+     * @param strategyName length-preserving strategy name.
+     * @param decrypt decrypt instead of encrypt.
+     * @param filePathFrom input path.
+     * @param filePathTo output path, already sized by the coordinator.
+     * @param begin first byte offset of the range.
+     * @param end byte offset past the range.
+     * @param manifestPart path of this range's manifest part.
+     * @param key key string.
+     * @return true if the range was written, false also for a range outside the input.
+     */
+    static bool runWorker(const std::string &strategyName, bool decrypt, const std::string &filePathFrom, const std::string &filePathTo,
+                          size_t begin, size_t end, const std::string &manifestPart, const std::string &key)
+    {
+        auto strategy = findChunkedStrategy(strategyName);
+        fileio::Descriptor input(filePathFrom, O_RDONLY);
+        fileio::Descriptor output(filePathTo, O_WRONLY);
+        if (!strategy || !input || !output || begin > end || end > size_t(input.size()))
+            return false;
+
+        std::uint64_t hash = kernels::HashBasis;
+        const LengthPreservingEncryptionStrategy::Job job(*strategy, key, decrypt);
+        const bool written = begin == end ||
+                             fileio::transformRange(input.get(), output.get(), begin, end, [&](char *buffer, size_t size, size_t offset)
+                                                    {
+                                                        job(buffer, buffer, size, offset);
+                                                        hash = kernels::hashBytes(buffer, size, hash);
+                                                        return true;
+                                                    });
+        if (!written)
+            return false;
+        {
+            trace::Span span("fsync", end - begin);
+            if (::fsync(output.get()) != 0)
+                return false;
+        }
+
+        std::ofstream part(manifestPart, std::ios::trunc);
+        part << begin << ' ' << end << ' ' << std::hex << hash << '\n';
+        return bool(part.flush());
+    }
+
+    /**
+     * @brief Check that the manifest covers the whole output without gaps and that
+     * every range still hashes to its recorded value.
+     * 
+     * @param filePathTo output path (the manifest is filePathTo + ".manifest").
+     * @return true if the output is complete and matches the manifest.
+     */
+    static bool verify(const std::string &filePathTo)
+    {
+        std::ifstream manifest(filePathTo + ".manifest");
+        std::string magic;
+        size_t size = 0, shards = 0;
+        if (!(manifest >> magic >> size >> shards) || magic != "sfe-shard-manifest-1")
+            return false;
+
+        fileio::Descriptor output(filePathTo, O_RDONLY);
+        if (!output || size_t(output.size()) != size)
+            return false;
+
+        std::vector<char> buffer(fileio::ChunkSize);
+        size_t covered = 0;
+        for (size_t shard = 0; shard < shards; shard++)
+        {
+            size_t begin = 0, end = 0;
+            std::uint64_t expected = 0;
+            if (!(manifest >> std::dec >> begin >> end >> std::hex >> expected) || begin != covered || end < begin || end > size)
+                return false;
+
+            std::uint64_t hash = kernels::HashBasis;
+            for (size_t offset = begin; offset < end; offset += buffer.size())
+            {
+                const size_t chunk = std::min(buffer.size(), end - offset);
+                if (!fileio::readAt(output.get(), buffer.data(), chunk, offset))
+                    return false;
+                hash = kernels::hashBytes(buffer.data(), chunk, hash);
+            }
+            if (hash != expected)
+                return false;
+            covered = end;
+        }
+        return covered == size;
+    }
+
+private:
+    /** @brief Path of the manifest part written by one worker. */
+    static std::string partPath(const std::string &filePathTo, size_t shard)
+    {
+        return filePathTo + ".manifest.part" + std::to_string(shard);
+    }
+
+    /**
+     * @brief Start a process with the given arguments and the input written to its stdin.
+     * A child that exits before reading (a failed execv) fails the spawn instead of killing
+     * this process with SIGPIPE.
+     */
+    static pid_t spawnWithInput(const std::vector<std::string> &arguments, const std::string &input)
+    {
+        int pipeFds[2];
+        if (::pipe2(pipeFds, O_CLOEXEC) != 0)
+            return -1;
+
+        std::vector<char *> argv;
+        for (const auto &argument : arguments)
+        {
+            argv.push_back(const_cast<char *>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        const pid_t child = ::fork();
+        if (child == 0)
+        {
+            ::dup2(pipeFds[0], STDIN_FILENO);
+            ::execv(argv[0], argv.data());
+            ::_exit(127);
+        }
+
+        ::close(pipeFds[0]);
+        // Pipes have no MSG_NOSIGNAL: block SIGPIPE around the write and drop one raised by it.
+        sigset_t pipeSignal, previous;
+        sigemptyset(&pipeSignal);
+        sigaddset(&pipeSignal, SIGPIPE);
+        ::pthread_sigmask(SIG_BLOCK, &pipeSignal, &previous);
+        const bool sent = child > 0 && fileio::writeAll(pipeFds[1], input.data(), input.size());
+        if (!sent && errno == EPIPE)
+        {
+            const timespec immediately{};
+            ::sigtimedwait(&pipeSignal, nullptr, &immediately);
+        }
+        ::pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+        ::close(pipeFds[1]);
+
+        if (!sent && child > 0)
+        {
+            ::waitpid(child, nullptr, 0);
+        }
+        return sent ? child : -1;
+    }
+
+
+    /** @brief Merge the manifest parts into the final manifest, checking completeness. */
+    static bool mergeManifest(const std::string &filePathTo, size_t size, size_t shards)
+    {
+        std::map<size_t, std::pair<size_t, std::string>> ranges;
+        for (size_t shard = 0; shard < shards; shard++)
+        {
+            std::ifstream part(partPath(filePathTo, shard));
+            size_t begin = 0, end = 0;
+            std::string hash;
+            if (part >> begin >> end >> hash)
+            {
+                ranges[begin] = {end, hash};
+            }
+            part.close();
+            std::remove(partPath(filePathTo, shard).c_str());
+        }
+
+        std::ofstream manifest(filePathTo + ".manifest", std::ios::trunc);
+        manifest << "sfe-shard-manifest-1\n"
+                 << size << ' ' << ranges.size() << '\n';
+
+        size_t covered = 0;
+        for (const auto &[begin, range] : ranges)
+        {
+            if (begin != covered)
+                return false;
+            manifest << begin << ' ' << range.first << ' ' << range.second << '\n';
+            covered = range.first;
+        }
+        return bool(manifest.flush()) && ranges.size() == shards && covered == size;
+    }
+};
+
+/**
+ * @brief Original scalar strategy implementations, kept as the byte-for-byte reference
+ * for the vectorized, table and parallel variants.
+ */
+namespace reference
+{
+    /** @brief XOR with key[i % key.size()]. */
+    inline std::string xorEncrypt(const std::string &text, const std::string &key)
+    {
+        if (key.empty())
+        {
+            return text;
+        }
+
+        std::string output{text};
+
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            output[i] = text[i] ^ key[i % key.size()];
+        }
+
+        return output;
+    }
+
+    /** @brief Caesar shift by shift % 255 (negative for decryption). */
+    inline std::string caesarShift(const std::string &text, const std::string &key, bool inverse)
+    {
+        std::string temp{text};
+        auto shift = std::stoull(key);
+
+        for (auto &ch : temp)
+        {
+            if (inverse)
+                ch -= char(shift % 255);
+            else
+                ch += char(shift % 255);
+        }
+
+        return temp;
+    }
+
+    /** @brief Binary code: eight '0'/'1' characters per byte. */
+    inline std::string binaryEncrypt(const std::string &text)
+    {
+        std::stringstream temp;
+
+        for (const auto &ch : text)
+        {
+            std::bitset<8> bs(static_cast<unsigned long long>(ch));
+            temp << bs.to_string();
+        }
+
+        return temp.str();
+    }
+
+    /** @brief Binary code decoding, eight characters per byte. */
+    inline std::string binaryDecrypt(const std::string &text)
+    {
+        std::stringstream decoded;
+
+        for (std::string::const_iterator segmentIterator{text.begin()}; segmentIterator != text.end(); segmentIterator += 8)
+        {
+            std::string segment(segmentIterator, segmentIterator + 8);
+            auto ASCII = std::stoull(segment, nullptr, 2);
+            decoded << char(ASCII);
+        }
+
+        return decoded.str();
+    }
+}
+
+/**
+ * @brief Differential verification of every kernel variant against the reference implementations.
+ *
+ * Runs each kernel the CPU supports over random lengths, buffer alignments, key lengths,
+ * chunk boundaries and thread counts, and compares the output byte for byte with the
+ * scalar reference. Used by the --self-check mode; the input-driven check is also suited
+ * as the body of a fuzzing entry point.
+ */
+class KernelVerifier
+{
+public:
+    /** @brief Seed of --self-check unless one is given, so plain runs are reproducible. */
+    static constexpr std::uint64_t DefaultSeed = 0x5EED5EED;
+
+    /**
+     * @brief Construct the verifier.
+     * 
+     * @param seed random seed, so failures are reproducible.
+     */
+    explicit KernelVerifier(std::uint64_t seed) : random{seed} {}
+
+    /**
+     * @brief Run randomized differential checks.
+     * 
+     * @param iterations number of random cases.
+     * @return true if every variant matched the reference.
+     */
+    bool run(size_t iterations)
+    {
+        checkKnownAnswers();
+        checkStreambufs();
+        for (size_t i = 0; i < iterations && failures == 0; i++)
+        {
+            const size_t maxSize = i % 16 == 0 ? (size_t(1) << 20) : 4096;
+            std::string text = randomBytes(random() % maxSize);
+            std::string key = randomBytes(randomKeySize());
+            check(text, key, random() % 9);
+        }
+        return failures == 0;
+    }
+
+    /**
+     * @brief Check all variants on one input; the first bytes select the key, the rest is the text.
+     * 
+     * @param data input bytes.
+     * @param size number of bytes.
+     * @return true if every variant matched the reference.
+     */
+    bool check(const char *data, size_t size)
+    {
+        const size_t keySize = size ? std::uint8_t(data[0]) % (size + 1) : 0;
+        const std::string key(data + (size ? 1 : 0), std::min(keySize, size ? size - 1 : 0));
+        const std::string text(data + std::min(size, 1 + key.size()), data + size);
+        check(text, key, key.size() % 9);
+        return failures == 0;
+    }
+
+private:
+    std::mt19937_64 random;
+    size_t failures = 0;
+
+    /** @brief Key lengths from empty through short, vector-sized and long-key paths. */
+    size_t randomKeySize()
+    {
+        static const size_t sizes[]{0, 1, 2, 3, 4, 7, 16, 31, 32, 33, 63, 64, 65, 255, 256, 1023, 1024, 4097, 70000};
+        return random() % 2 ? sizes[random() % (sizeof(sizes) / sizeof(sizes[0]))] : random() % 300;
+    }
+
+    std::string randomBytes(size_t size)
+    {
+        std::string bytes(size, '\0');
+        for (auto &ch : bytes)
+        {
+            ch = char(random());
+        }
+        return bytes;
+    }
+
+    void expect(bool matched, const char *variant, size_t textSize, size_t keySize)
+    {
+        if (!matched)
+        {
+            failures++;
+            std::fprintf(stderr, "self-check: %s differs from the reference (text %zu bytes, key %zu bytes)\n", variant, textSize, keySize);
+        }
+    }
+
+    /** @brief Published test vectors of the primitives whose scalar code is itself the reference. */
+    void checkKnownAnswers()
+    {
+        // Random123 kat_vectors, philox4x32 with 10 rounds: counter, key, output.
+        struct PhiloxVector
+        {
+            std::array<std::uint32_t, 4> counter;
+            std::array<std::uint32_t, 2> key;
+            std::array<std::uint32_t, 4> output;
+        };
+        static const PhiloxVector philoxVectors[]{
+            {{0x00000000, 0x00000000, 0x00000000, 0x00000000}, {0x00000000, 0x00000000}, {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8}},
+            {{0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff}, {0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd}},
+            {{0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0}, {0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1}},
+        };
+        for (const auto &vector : philoxVectors)
+        {
+            const kernels::Philox generator(vector.key, {vector.counter[2], vector.counter[3]});
+            const std::uint64_t block = vector.counter[0] | std::uint64_t(vector.counter[1]) << 32;
+            std::array<std::uint32_t, 4> words;
+            generator.generate(block, reinterpret_cast<char *>(words.data()));
+            expect(words == vector.output, "Philox::generate known answer", kernels::Philox::BlockSize, 8);
+#ifdef SFE_X86_SIMD
+            if (kernels::cpu().avx2)
+            {
+                // The first of the eight lanes starts at the vector's counter.
+                std::array<std::uint32_t, 32> lanes{};
+                generator.xorEightBlocksAVX2(block, reinterpret_cast<const char *>(lanes.data()), reinterpret_cast<char *>(lanes.data()));
+                expect(std::equal(vector.output.begin(), vector.output.end(), lanes.begin()), "Philox::xorEightBlocksAVX2 known answer", kernels::Philox::BlockSize, 8);
+            }
+#endif
+        }
+
+        // RFC 7914 section 11, PBKDF2-HMAC-SHA256, and RFC 5869 test case 1, HKDF-SHA256.
+        const auto hex = [](const std::string &bytes)
+        {
+            static const char digits[] = "0123456789abcdef";
+            std::string text;
+            for (const char ch : bytes)
+            {
+                text += digits[std::uint8_t(ch) >> 4];
+                text += digits[std::uint8_t(ch) & 15];
+            }
+            return text;
+        };
+        expect(hex(kdf::pbkdf2Sha256("passwd", "salt", 1, 64)) ==
+                   "55ac046e56e3089fec1691c22544b605f94185216dde0465e68b9d57c20dacbc49ca9cccf179b645991664b39d77ef317c71b845b1e30bd509112041d3a19783",
+               "pbkdf2Sha256 known answer", 6, 4);
+        expect(hex(kdf::pbkdf2Sha256("Password", "NaCl", 80000, 64)) ==
+                   "4ddcd8f60b98be21830cee5ef22701f9641a4418d04c0414aeff08876b34ab56a1d425a1225833549adb841b51c9b3176a272bdebba1d078478f62b397f33c8d",
+               "pbkdf2Sha256 known answer", 8, 4);
+        std::string salt, info;
+        for (int i = 0; i < 13; i++)
+            salt += char(i);
+        for (int i = 0xf0; i < 0xfa; i++)
+            info += char(i);
+        expect(hex(kdf::hkdfSha256(std::string(22, '\x0b'), salt, info, 42)) ==
+                   "3cb25f25faacd57a90434f64d0362f2a2d2d0a90cf1a5a4c5db02d56ecc4c5bf34007208d5b887185865",
+               "hkdfSha256 known answer", 22, 13);
+
+        // Containers sharing a salt derive the passphrase once and still get distinct keys.
+        kdf::Header first, second;
+        first.params.iterations = second.params.iterations = 1000;
+        first.params.salt = second.params.salt = kdf::randomSalt();
+        first.fileSalt = kdf::randomSalt();
+        second.fileSalt = kdf::randomSalt();
+        const size_t derivations = kdf::derivations().load();
+        const bool distinct = kdf::fileKey("passphrase", first) != kdf::fileKey("passphrase", second);
+        expect(distinct && kdf::derivations().load() == derivations + 1, "kdf::deriveKey cache", 0, 10);
+    }
+
+    /** @brief Seeks of DecryptingStreambuf over a stream buffer and a file descriptor, inside and outside the decrypted chunk. */
+    void checkStreambufs()
+    {
+        const std::string key = "streambuf";
+        const std::string text = randomBytes(100);
+        const std::string encrypted = reference::xorEncrypt(text, key);
+        const auto strategy = std::dynamic_pointer_cast<const LengthPreservingEncryptionStrategy>(findStrategy("xor"));
+
+        // Read one byte, seek from the end, read the rest: the seek lands inside the decrypted chunk.
+        const auto tail = [&](std::streambuf &buffer)
+        {
+            std::istream in(&buffer);
+            in.get();
+            in.seekg(-10, std::ios::end);
+            return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        };
+
+        std::stringbuf source(encrypted);
+        DecryptingStreambuf fromBuffer(&source, strategy, key);
+        expect(tail(fromBuffer) == text.substr(90), "DecryptingStreambuf::seekoff", text.size(), key.size());
+
+        FILE *file = std::tmpfile();
+        if (file && fileio::writeAll(::fileno(file), encrypted.data(), encrypted.size()) && ::lseek(::fileno(file), 0, SEEK_SET) == 0)
+        {
+            DecryptingStreambuf fromDescriptor(::fileno(file), strategy, key);
+            expect(tail(fromDescriptor) == text.substr(90), "DecryptingStreambuf::seekoff (descriptor)", text.size(), key.size());
+        }
+        if (file)
+            std::fclose(file);
+    }
+
+    /** @brief Run fn(in, out, size, offset) over text placed at a random alignment and split at random chunk boundaries. */
+
+    template <typename Fn>
+    std::string chunked(const std::string &text, Fn &&fn)
+    {
+        const size_t shift = random() % 64;
+        std::string input(text.size() + shift, '\0'), output(text.size() + shift, '\0');
+        std::copy(text.begin(), text.end(), input.begin() + shift);
+
+        for (size_t begin = 0; begin < text.size();)
+        {
+            const size_t size = std::min(text.size() - begin, size_t(1 + random() % 5000));
+            fn(input.data() + shift + begin, output.data() + shift + begin, size, begin);
+            begin += size;
+        }
+        return output.substr(shift);
+    }
+
+    void check(const std::string &text, const std::string &key, size_t threads)
+    {
+        const std::string caesarKey = std::to_string(random() % 100000);
+        const std::string xorExpected = reference::xorEncrypt(text, key);
+        const std::string caesarExpected = reference::caesarShift(text, caesarKey, false);
+
+        // Repeating-pattern and long-key XOR kernels.
+        const kernels::RepeatingPattern pattern(key);
+        if (!key.empty())
+        {
+            expect(chunked(text, [&](const char *in, char *out, size_t size, size_t offset)
+                           { kernels::applyPatternScalar<kernels::PatternOp::Xor>(pattern, in, out, size, offset % key.size()); }) == xorExpected,
+                   "applyPatternScalar<Xor>", text.size(), key.size());
+            expect(chunked(text, [&](const char *in, char *out, size_t size, size_t offset)
+                           { kernels::xorLongKey(key.data(), key.size(), in, out, size, offset); }) == xorExpected,
+                   "xorLongKey", text.size(), key.size());
+#ifdef SFE_X86_SIMD
+            if (kernels::cpu().avx2)
+            {
+                expect(chunked(text, [&](const char *in, char *out, size_t size, size_t offset)
+                               { kernels::applyPatternAVX2<kernels::PatternOp::Xor>(pattern, in, out, size, offset % key.size()); }) == xorExpected,
+                       "applyPatternAVX2<Xor>", text.size(), key.size());
+                expect(chunked(text, [&](const char *in, char *out, size_t size, size_t offset)
+                               { kernels::applyPatternAVX2<kernels::PatternOp::Xor, true>(pattern, in, out, size, offset % key.size()); }) == xorExpected,
+                       "applyPatternAVX2<Xor, streaming>", text.size(), key.size());
+            }
+#endif
+        }
+
+        // Fused two-stream XOR against the pad-sized reference.
+        const std::string pad = randomBytes(text.size());
+        const std::string padExpected = reference::xorEncrypt(text, pad);
+        std::string padOutput(text.size(), '\0');
+        kernels::xorStreamsScalar(text.data(), pad.data(), padOutput.data(), text.size());
+        expect(padOutput == padExpected || text.empty(), "xorStreamsScalar", text.size(), pad.size());
+#ifdef SFE_X86_SIMD
+        if (kernels::cpu().avx2)
+        {
+            kernels::xorStreamsAVX2(text.data(), pad.data(), padOutput.data(), text.size());
+            expect(padOutput == padExpected || text.empty(), "xorStreamsAVX2", text.size(), pad.size());
+        }
+#endif
+
+        // First-difference search against a byte at a random position.
+        if (!text.empty())
+        {
+            std::string altered{text};
+            const size_t position = random() % text.size();
+            altered[position] = char(~altered[position]);
+            std::vector<std::pair<const char *, size_t (*)(const char *, const char *, size_t)>> differenceKernels{{"firstDifferenceScalar", kernels::firstDifferenceScalar}};
+#ifdef SFE_X86_SIMD
+            if (kernels::cpu().avx2)
+            {
+                differenceKernels.emplace_back("firstDifferenceAVX2", kernels::firstDifferenceAVX2);
+            }
+#endif
+            for (const auto &[name, kernel] : differenceKernels)
+            {
+                expect(kernel(text.data(), altered.data(), text.size()) == position && kernel(text.data(), text.data(), text.size()) == text.size(),
+                       name, text.size(), 0);
+            }
+        }
+
+        // BLAKE3 chunk chaining values, eight lanes against one chunk at a time.
+#ifdef SFE_X86_SIMD
+        if (kernels::cpu().avx2 && text.size() >= 8 * blake3::ChunkSize)
+        {
+            const std::uint64_t index = random() % 4096;
+            blake3::ChainingValue lanes[8];
+            blake3::chunks8AVX2(text.data(), index, lanes);
+            bool same = true;
+            for (size_t i = 0; i < 8; i++)
+            {
+                same = same && lanes[i] == blake3::chunk(text.data() + i * blake3::ChunkSize, blake3::ChunkSize, index + i);
+            }
+            expect(same, "blake3::chunks8AVX2", text.size(), 0);
+        }
+#endif
+
+        // Byte substitution with the Caesar table and a keyed table.
+        SubstitutionEncryptionStrategy substitution;
+        const kernels::ByteTable caesarTable = substitution.makeTable(caesarKey);
+        const kernels::ByteTable keyedTable = substitution.makeTable(key);
+        std::string keyedExpected{text};
+        for (auto &ch : keyedExpected)
+        {
+            ch = char(keyedTable[std::uint8_t(ch)]);
+        }
+
+        using SubstituteKernel = void (*)(const kernels::ByteTable &, const char *, char *, size_t);
+        std::vector<std::pair<const char *, SubstituteKernel>> substituteKernels{{"substituteScalar", kernels::substituteScalar}};
+#ifdef SFE_X86_SIMD
+        if (kernels::cpu().avx2)
+        {
+            substituteKernels.emplace_back("substituteAVX2", kernels::substituteAVX2);
+        }
+        if (kernels::cpu().avx512vbmi)
+        {
+            substituteKernels.emplace_back("substituteVBMI", kernels::substituteVBMI);
+        }
+#endif
+        for (const auto &[name, kernel] : substituteKernels)
+        {
+            expect(chunked(text, [&](const char *in, char *out, size_t size, size_t)
+                           { kernel(caesarTable, in, out, size); }) == caesarExpected,
+                   name, text.size(), caesarKey.size());
+            expect(chunked(text, [&](const char *in, char *out, size_t size, size_t)
+                           { kernel(keyedTable, in, out, size); }) == keyedExpected,
+                   name, text.size(), key.size());
+        }
+
+        // Keystream: vectorized blocks against one scalar block at a time.
+        const kernels::Philox generator(key);
+        std::string keystreamExpected{text};
+        char block[kernels::Philox::BlockSize];
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (i % kernels::Philox::BlockSize == 0)
+            {
+                generator.generate(i / kernels::Philox::BlockSize, block);
+            }
+            keystreamExpected[i] ^= block[i % kernels::Philox::BlockSize];
+        }
+        expect(chunked(text, [&](const char *in, char *out, size_t size, size_t offset)
+                       { kernels::xorKeystream(generator, in, out, size, offset); }) == keystreamExpected,
+               "xorKeystream", text.size(), key.size());
+
+        // Whole strategies split across threads, in both directions.
+        XOREncryptionStrategy xorStrategy;
+        CaesarEncryptionStrategy caesar;
+        VigenereEncryptionStrategy vigenere;
+        const auto parallelRun = [&](const LengthPreservingEncryptionStrategy &strategy, const std::string &input, const std::string &strategyKey, bool decrypt)
+        {
+            std::string output(input.size(), '\0');
+            parallel::forChunks(
+                input.size(), [&](size_t begin, size_t end)
+                {
+                    if (decrypt)
+                        strategy.decryptChunk(input.data() + begin, output.data() + begin, end - begin, begin, strategyKey);
+                    else
+                        strategy.encryptChunk(input.data() + begin, output.data() + begin, end - begin, begin, strategyKey);
+                },
+                threads);
+            return output;
+        };
+
+        expect(parallelRun(xorStrategy, text, key, false) == xorExpected, "XOREncryptionStrategy::encryptChunk", text.size(), key.size());
+        expect(parallelRun(xorStrategy, xorExpected, key, true) == text, "XOREncryptionStrategy::decryptChunk", text.size(), key.size());
+        expect(parallelRun(caesar, text, caesarKey, false) == caesarExpected, "CaesarEncryptionStrategy::encryptChunk", text.size(), caesarKey.size());
+        expect(parallelRun(caesar, caesarExpected, caesarKey, true) == reference::caesarShift(caesarExpected, caesarKey, true),
+               "CaesarEncryptionStrategy::decryptChunk", text.size(), caesarKey.size());
+        expect(parallelRun(vigenere, text, caesarKey, false) == caesarExpected, "VigenereEncryptionStrategy::encryptChunk", text.size(), caesarKey.size());
+        expect(parallelRun(substitution, text, caesarKey, false) == caesarExpected, "SubstitutionEncryptionStrategy::encryptChunk", text.size(), caesarKey.size());
+        expect(parallelRun(substitution, keyedExpected, key, true) == text, "SubstitutionEncryptionStrategy::decryptChunk", text.size(), key.size());
+
+        // Single-pass re-keying against decrypt-then-encrypt with the reference.
+        const std::string newKey = randomBytes(randomKeySize());
+        const std::string newCaesarKey = std::to_string(random() % 100000);
+        expect(xorStrategy.rekey(xorExpected, key, newKey) == reference::xorEncrypt(text, newKey), "XOREncryptionStrategy::rekeyChunk", text.size(), newKey.size());
+        expect(caesar.rekey(caesarExpected, caesarKey, newCaesarKey) == reference::caesarShift(text, newCaesarKey, false),
+               "CaesarEncryptionStrategy::rekeyChunk", text.size(), newCaesarKey.size());
+        expect(substitution.rekey(keyedExpected, key, newCaesarKey) == reference::caesarShift(text, newCaesarKey, false),
+               "SubstitutionEncryptionStrategy::rekeyChunk", text.size(), newCaesarKey.size());
+
+        // Phased needle scanner against a brute-force search of the XOR ciphertext.
+        if (!text.empty())
+        {
+            const size_t needleSize = 1 + random() % std::min<size_t>(8, text.size());
+            const std::string needle = text.substr(random() % (text.size() - needleSize + 1), needleSize);
+            const size_t period = xorStrategy.keyPeriod(key);
+            std::string patterns(period * needleSize, '\0');
+            for (size_t phase = 0; phase < period; phase++)
+            {
+                xorStrategy.encryptChunk(needle.data(), &patterns[phase * needleSize], needleSize, phase, key);
+            }
+
+            std::vector<size_t> found, expected;
+            kernels::PhasedNeedleScanner(patterns, needleSize, period).scan(xorExpected.data(), xorExpected.size(), 0, xorExpected.size(), found);
+            for (size_t offset = 0; offset + needleSize <= text.size(); offset++)
+            {
+                if (text.compare(offset, needleSize, needle) == 0)
+                {
+                    expected.push_back(offset);
+                }
+            }
+            expect(found == expected, "PhasedNeedleScanner", text.size(), key.size());
+        }
+
+        // Binary code on a short prefix (eight output characters per byte).
+        const std::string binaryText = text.substr(0, 4096);
+        BinaryEncryptionStrategy binary;
+        const std::string binaryExpected = reference::binaryEncrypt(binaryText);
+        expect(binary.encrypt(binaryText, "") == binaryExpected, "BinaryEncryptionStrategy::encrypt", binaryText.size(), 0);
+        expect(binary.decrypt(binaryExpected, "") == reference::binaryDecrypt(binaryExpected), "BinaryEncryptionStrategy::decrypt", binaryText.size(), 0);
+
+        using ExpandKernel = void (*)(const char *, char *, size_t);
+        std::vector<std::pair<const char *, ExpandKernel>> expandKernels{{"expandBitsScalar", kernels::expandBitsScalar}};
+#ifdef SFE_X86_SIMD
+        if (kernels::cpu().avx2)
+        {
+            expandKernels.emplace_back("expandBitsAVX2", kernels::expandBitsAVX2<false>);
+            expandKernels.emplace_back("expandBitsAVX2<streaming>", kernels::expandBitsAVX2<true>);
+        }
+#endif
+        for (const auto &[name, kernel] : expandKernels)
+        {
+            const size_t shift = random() % 64;
+            std::string output(binaryExpected.size() + shift, '\0');
+            kernel(binaryText.data(), output.data() + shift, binaryText.size());
+            expect(output.substr(shift) == binaryExpected, name, binaryText.size(), 0);
+        }
+
+        // Block-wise decoding (packBits), as streamed by IFileEncryptor.
+        std::string packed(binaryText.size(), '\0');
+        binary.transformBlocks(binaryExpected.data(), binaryExpected.size(), &packed[0], "", true);
+        expect(packed == reference::binaryDecrypt(binaryExpected), "BinaryEncryptionStrategy::transformBlocks", binaryText.size(), 0);
+    }
+};
+
+/**
+ * @brief Parse a whole decimal command line number.
+ * 
+ * @param text argument.
+ * @param value receives the number.
+ * @return false if the argument is not a decimal number or does not fit.
+ */
+bool parseNumber(const char *text, unsigned long long &value)
+{
+    char *end = nullptr;
+    errno = 0;
+    value = std::strtoull(text, &end, 10);
+    return *text >= '0' && *text <= '9' && *end == '\0' && errno != ERANGE;
+}
+
+/** @return passphrase read from the standard input, without its trailing newline. */
+std::string readPassphrase()
+{
+    std::string passphrase = fileio::readAll(STDIN_FILENO);
+    if (!passphrase.empty() && passphrase.back() == '\n')
+        passphrase.pop_back();
+    return passphrase;
+}
+
+/**
+ * @brief Command line dispatch.
+ * 
+ * @param argc argument count.
+ * @param argv arguments.
+ * @return process exit code.
+ */
+int run(int argc, char *argv[])
+{
+    // Plugins named in SFE_PLUGINS (inherited by shard workers), then leading --plugin <path>, --stores <mode> and --trace <path> options.
+    if (!StrategyPlugins::loadFromEnvironment())
+    {
+        std::fprintf(stderr, "cannot load a plugin listed in SFE_PLUGINS\n");
+        return 1;
+    }
+    // A trace requested by a parent (shard coordinator) goes to a per-process file next to it.
+    if (const char *inherited = std::getenv("SFE_TRACE"))
+    {
+        trace::start(std::string(inherited) + "." + std::to_string(::getpid()));
+    }
+    while (argc > 2 && (std::string(argv[1]) == "--plugin" || std::string(argv[1]) == "--stores" || std::string(argv[1]) == "--trace"))
+    {
+        if (std::string(argv[1]) == "--trace")
+        {
+            // --trace <file.json>, written at exit.
+            trace::start(argv[2]);
+            ::setenv("SFE_TRACE", argv[2], 1);
+        }
+        else if (std::string(argv[1]) == "--stores")
+        {
+            // --stores auto|regular|streaming for outputs built in memory (Binary files, string
+            // methods), exported like the plugins so shard workers inherit it.
+            kernels::StoreMode mode;
+            if (!kernels::parseStoreMode(argv[2], mode))
+            {
+                std::fprintf(stderr, "unknown store mode %s\n", argv[2]);
+                return 1;
+            }
+            kernels::storeMode() = mode;
+            ::setenv("SFE_STORES", argv[2], 1);
+        }
+        else if (!StrategyPlugins::load(argv[2]))
+        {
+            std::fprintf(stderr, "cannot load plugin %s\n", argv[2]);
+            return 1;
+        }
+        else
+        {
+            const char *inherited = std::getenv("SFE_PLUGINS");
+            ::setenv("SFE_PLUGINS", (inherited && *inherited ? std::string(inherited) + ":" + argv[2] : std::string(argv[2])).c_str(), 1);
+        }
+        argv += 2;
+        argc -= 2;
+    }
+
+    if ((argc == 5 || argc == 6) && (std::string(argv[1]) == "--encrypt" || std::string(argv[1]) == "--decrypt"))
+    {
+        // --encrypt|--decrypt <strategy> <from> <to> [key]
+        IFileEncryptor fileEncryptor;
+        const StrategyHandle strategy = findStrategy(argv[2]);
+        if (!strategy)
+        {
+            std::fprintf(stderr, "unknown strategy %s\n", argv[2]);
+            return 1;
+        }
+        fileEncryptor.setStrategy(strategy);
+        const std::string key = argc == 6 ? argv[5] : "";
+        const bool done = std::string(argv[1]) == "--encrypt" ? fileEncryptor.encrypt(argv[3], argv[4], key)
+                                                                : fileEncryptor.decrypt(argv[3], argv[4], key);
+        return done ? 0 : 1;
+    }
+
+    if (argc > 1 && std::string(argv[1]) == "--self-check")
+    {
+        unsigned long long iterations = 1000, seed = KernelVerifier::DefaultSeed;
+        if ((argc > 2 && !parseNumber(argv[2], iterations)) || (argc > 3 && !parseNumber(argv[3], seed)))
+        {
+            std::fprintf(stderr, "invalid self-check arguments\n");
+            return 2;
+        }
+        std::printf("self-check: %llu iterations, seed %llu\n", iterations, seed);
+        return KernelVerifier(seed).run(iterations) ? 0 : 1;
+    }
+
+    if (argc == 7 && std::string(argv[1]) == "--rekey")
+    {
+        // --rekey <strategy> <from> <to> <old key> <new key>
+        IFileEncryptor fileEncryptor;
+        fileEncryptor.setStrategy(findStrategy(argv[2]));
+        return fileEncryptor.rekey(argv[3], argv[4], argv[5], argv[6]) ? 0 : 1;
+    }
+
+    if (argc >= 6 && (argc - 3) % 3 == 0 && std::string(argv[1]) == "--fan-out")
+    {
+        // --fan-out <from> <strategy> <to> <key> [<strategy> <to> <key> ...]
+        std::vector<IFileEncryptor::FanOutTarget> targets;
+        for (int i = 3; i + 2 < argc; i += 3)
+        {
+            targets.push_back({argv[i + 1], findStrategy(argv[i]), argv[i + 2]});
+        }
+        return IFileEncryptor().encryptFanOut(argv[2], targets) ? 0 : 1;
+    }
+
+    if (argc >= 7 && argc % 2 == 1 && std::string(argv[1]) == "--batch")
+    {
+        // --batch <strategy> <encrypt|decrypt> <key> <from> <to> [<from> <to> ...]
+        IFileEncryptor fileEncryptor;
+        fileEncryptor.setStrategy(findStrategy(argv[2]));
+        std::vector<IFileEncryptor::BatchJob> jobs;
+        for (int i = 5; i + 1 < argc; i += 2)
+        {
+            jobs.push_back({argv[i], argv[i + 1], argv[4]});
+        }
+        return (std::string(argv[3]) == "decrypt" ? fileEncryptor.decryptBatch(jobs) : fileEncryptor.encryptBatch(jobs)) ? 0 : 1;
+    }
+
+    if ((argc == 5 || argc == 6) && (std::string(argv[1]) == "--encrypt-passphrase" || std::string(argv[1]) == "--decrypt-passphrase"))
+    {
+        // --encrypt-passphrase|--decrypt-passphrase <strategy> <from> <to> [iterations], passphrase on stdin.
+        IFileEncryptor fileEncryptor;
+        fileEncryptor.setStrategy(findStrategy(argv[2]));
+        kdf::Params params;
+        unsigned long long iterations = params.iterations;
+        if (argc == 6 && (!parseNumber(argv[5], iterations) || iterations == 0 || iterations > kdf::Header::MaxIterations))
+        {
+            std::fprintf(stderr, "invalid iteration count %s\n", argv[5]);
+            return 2;
+        }
+        params.iterations = std::uint32_t(iterations);
+        const std::string passphrase = readPassphrase();
+
+        if (std::string(argv[1]) == "--decrypt-passphrase")
+            return fileEncryptor.decryptWithPassphrase(argv[3], argv[4], passphrase) ? 0 : 1;
+        return fileEncryptor.encryptWithPassphrase(argv[3], argv[4], passphrase, params) ? 0 : 1;
+    }
+
+    if ((argc >= 6 && argc % 2 == 0 && std::string(argv[1]) == "--encrypt-passphrase-batch") ||
+        (argc >= 5 && argc % 2 == 1 && std::string(argv[1]) == "--decrypt-passphrase-batch"))
+    {
+        // --encrypt-passphrase-batch <strategy> <iterations> <from> <to> [<from> <to> ...]
+        // --decrypt-passphrase-batch <strategy> <from> <to> [<from> <to> ...], passphrase on stdin.
+        const bool decrypting = std::string(argv[1]) == "--decrypt-passphrase-batch";
+        IFileEncryptor fileEncryptor;
+        fileEncryptor.setStrategy(findStrategy(argv[2]));
+        unsigned long long iterations = 0;
+        if (!decrypting && (!parseNumber(argv[3], iterations) || iterations == 0 || iterations > kdf::Header::MaxIterations))
+        {
+            std::fprintf(stderr, "invalid iteration count %s\n", argv[3]);
+            return 2;
+        }
+        std::vector<IFileEncryptor::BatchJob> jobs;
+        for (int i = decrypting ? 3 : 4; i + 1 < argc; i += 2)
+        {
+            jobs.push_back({argv[i], argv[i + 1], ""});
+        }
+        const std::string passphrase = readPassphrase();
+
+        if (decrypting)
+            return fileEncryptor.decryptBatchWithPassphrase(jobs, passphrase) ? 0 : 1;
+        kdf::Params params;
+        params.iterations = std::uint32_t(iterations);
+        return fileEncryptor.encryptBatchWithPassphrase(jobs, passphrase, params) ? 0 : 1;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "--verify")
+    {
+        // --verify <strategy> <original> <encrypted> <key>
+        IFileEncryptor fileEncryptor;
+        fileEncryptor.setStrategy(findStrategy(argv[2]));
+        long long mismatch;
+        if (!fileEncryptor.verify(argv[3], argv[4], argv[5], mismatch))
+            return 2;
+        if (mismatch >= 0)
+        {
+            std::printf("mismatch at %lld\n", mismatch);
+            return 1;
+        }
+        return 0;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "--encrypt-manifest")
+    {
+        // --encrypt-manifest <strategy> <from> <to> <key>, manifest written to <to>.merkle
+        IFileEncryptor fileEncryptor;
+        fileEncryptor.setStrategy(findStrategy(argv[2]));
+        return fileEncryptor.encryptWithManifest(argv[3], argv[4], argv[5]) ? 0 : 1;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "--verify-manifest")
+    {
+        // --verify-manifest <file> <manifest> <begin> <end>
+        unsigned long long begin, end;
+        if (!parseNumber(argv[4], begin) || !parseNumber(argv[5], end))
+        {
+            std::fprintf(stderr, "invalid range %s %s\n", argv[4], argv[5]);
+            return 2;
+        }
+        return merkle::verifyRange(argv[2], argv[3], begin, end) ? 0 : 1;
+    }
+
+    if (argc == 6 && std::string(argv[1]) == "--search")
+    {
+        // --search <strategy> <encrypted file> <needle> <key>
+        IFileEncryptor fileEncryptor;
+        fileEncryptor.setStrategy(findStrategy(argv[2]));
+        std::vector<size_t> matches;
+        if (!fileEncryptor.encryptedSearch(argv[3], argv[4], argv[5], matches))
+            return 2;
+        for (const auto &offset : matches)
+        {
+            std::printf("%zu\n", offset);
+        }
+        return matches.empty() ? 1 : 0;
+    }
+
+    if (argc == 8 && std::string(argv[1]) == "--shard")
+    {
+        // --shard <strategy> <encrypt|decrypt> <from> <to> <key> <workers>
+        unsigned long long workers;
+        if (!parseNumber(argv[7], workers) || workers == 0)
+        {
+            std::fprintf(stderr, "invalid worker count %s\n", argv[7]);
+            return 2;
+        }
+        return ShardedFileEncryptor::run("/proc/self/exe", argv[2], std::string(argv[3]) == "decrypt",
+                                         argv[4], argv[5], argv[6], workers)
+                   ? 0
+                   : 1;
+    }
+
+    if (argc == 9 && std::string(argv[1]) == "--shard-worker")
+    {
+        // --shard-worker <strategy> <encrypt|decrypt> <from> <to> <begin> <end> <manifest part>, key on stdin
+        unsigned long long begin, end;
+        if (!parseNumber(argv[6], begin) || !parseNumber(argv[7], end))
+        {
+            std::fprintf(stderr, "invalid range %s %s\n", argv[6], argv[7]);
+            return 2;
+        }
+        return ShardedFileEncryptor::runWorker(argv[2], std::string(argv[3]) == "decrypt", argv[4], argv[5],
+                                               begin, end, argv[8], fileio::readAll(STDIN_FILENO))
+                   ? 0
+                   : 1;
+
+    }
+
+    if (argc == 3 && std::string(argv[1]) == "--shard-verify")
+    {
+        return ShardedFileEncryptor::verify(argv[2]) ? 0 : 1;
+    }
+
+
+    const std::string key{"3abc"};
+    IFileEncryptor fileEncryptor;
+
+    fileEncryptor.setStrategy(findStrategy("xor"));
+    fileEncryptor.encrypt(".files/XOR/XOR_Original.txt", ".files/XOR/XOR_Crypted.txt", key);
+    fileEncryptor.decrypt(".files/XOR/XOR_Crypted.txt", ".files/XOR/XOR_Decrypted.txt", key);
+
+    fileEncryptor.setStrategy(findStrategy("caesar"));
+    fileEncryptor.encrypt(".files/Caesar/Caesar_Original.txt", ".files/Caesar/Caesar_Crypted.txt", key);
+    fileEncryptor.decrypt(".files/Caesar/Caesar_Crypted.txt", ".files/Caesar/Caesar_Decrypted.txt", key);
+
+    fileEncryptor.setStrategy(findStrategy("binary"));
+    fileEncryptor.encrypt(".files/Binary/Binary_Original.txt", ".files/Binary/Binary_Crypted.txt");
+    fileEncryptor.decrypt(".files/Binary/Binary_Crypted.txt", ".files/Binary/Binary_Decrypted.txt");
+    return 0;
+}
+
+#ifdef SFE_FUZZ
+/**
+ * @brief libFuzzer entry point: every kernel variant on one input against the scalar reference
+ * (see KernelVerifier::check). Replaces main; build with -DSFE_FUZZ -fsanitize=fuzzer.
+ * 
+ * @param data input bytes.
+ * @param size number of bytes.
+ * @return 0; a mismatch aborts so libFuzzer keeps the input.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data, size_t size)
+{
+    // Seeded from the input alone, so a saved crash reproduces when run by itself.
+    KernelVerifier verifier(kernels::hashBytes(reinterpret_cast<const char *>(data), size));
+    if (!verifier.check(reinterpret_cast<const char *>(data), size))
+
+        std::abort();
+    return 0;
+}
+#else
+int main(int argc, char *argv[])
+{
+    // Strategies reject malformed keys (a non-numeric Caesar shift) by throwing, also from worker threads.
+    try
+    {
+        return run(argc, argv);
+    }
+    catch (const std::exception &e)
+    {
+        std::fprintf(stderr, "error: %s\n", e.what());
+        return 1;
+    }
 }
+#endif
@@ -0,0 +1,100 @@
+/**
+ * @file strategy_plugin.h
+ * @brief Stable C ABI for encryption strategy plugins loaded with dlopen.
+ *
+ * A plugin is a shared library exporting SFE_PLUGIN_ENTRY_SYMBOL:
+ *
+ * @code
+ * const sfe_strategy_plugin *sfe_strategy_plugin_entry(uint32_t host_abi_version);
+ * @endcode
+ *
+ * The host passes its SFE_PLUGIN_ABI_VERSION; the plugin returns a descriptor with the same
+ * major version, or NULL if it cannot serve that host. The descriptor and its name must stay
+ * valid until the process exits (plugins are never unloaded).
+ *
+ * Length-preserving plugins implement transform(), which maps size bytes at a stream offset
+ * to size bytes. If they are also seekable, any range can be transformed independently with
+ * the same context from several threads at once, so they get the chunked, parallel and
+ * sharded file pipelines of the built-in strategies. Other plugins implement the streaming
+ * transform_stream() and are driven sequentially from offset 0.
+ */
+#ifndef STRATEGY_PLUGIN_H
+#define STRATEGY_PLUGIN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @brief ABI version: major in the high 16 bits, minor (compatible additions) in the low 16 bits. */
+#define SFE_PLUGIN_ABI_VERSION ((1u << 16) | 0u)
+
+/** @brief Name of the exported entry point. */
+#define SFE_PLUGIN_ENTRY_SYMBOL "sfe_strategy_plugin_entry"
+
+/** @brief Every output byte depends on exactly one input byte; transform() is provided. */
+#define SFE_CAP_LENGTH_PRESERVING (1u << 0)
+/** @brief transform() accepts any offset in any order, concurrently on one context. */
+#define SFE_CAP_SEEKABLE (1u << 1)
+/** @brief The plugin has AVX2 kernels. */
+#define SFE_CAP_SIMD_AVX2 (1u << 2)
+/** @brief The plugin has AVX-512 kernels. */
+#define SFE_CAP_SIMD_AVX512 (1u << 3)
+
+/** @brief Direction passed to create(). */
+#define SFE_ENCRYPT 0
+#define SFE_DECRYPT 1
+
+    /** @brief Plugin descriptor returned by the entry point. */
+    typedef struct sfe_strategy_plugin
+    {
+        /** @brief SFE_PLUGIN_ABI_VERSION the plugin was built against. */
+        uint32_t abi_version;
+
+        /** @brief SFE_CAP_* flags. */
+        uint32_t capabilities;
+
+        /** @brief Strategy name used to select it, e.g. "rot13". */
+        const char *name;
+
+        /**
+         * @brief Create a context for one key and direction.
+         * @return context, or NULL on an invalid key.
+         */
+        void *(*create)(const unsigned char *key, size_t key_size, int direction);
+
+        /** @brief Destroy a context returned by create(). */
+        void (*destroy)(void *context);
+
+        /**
+         * @brief Length-preserving transform of size bytes at a stream offset (in may equal out).
+         * Required with SFE_CAP_LENGTH_PRESERVING, otherwise NULL.
+         * @return 0 on success.
+         */
+        int (*transform)(void *context, const unsigned char *in, unsigned char *out, size_t size, uint64_t offset);
+
+        /**
+         * @brief Streaming transform for plugins that are not length-preserving.
+         * Consumes size input bytes (size 0 with final set flushes) and writes at most
+         * out_capacity bytes, the count being stored in *out_size. The host provides
+         * max_output(size) bytes of capacity. Required without SFE_CAP_LENGTH_PRESERVING.
+         * @return 0 on success.
+         */
+        int (*transform_stream)(void *context, const unsigned char *in, size_t size, int final,
+                                unsigned char *out, size_t out_capacity, size_t *out_size);
+
+        /** @brief Upper bound of the output produced by transform_stream() for size input bytes. */
+        size_t (*max_output)(void *context, size_t size);
+    } sfe_strategy_plugin;
+
+    /** @brief Type of the exported entry point. */
+    typedef const sfe_strategy_plugin *(*sfe_strategy_plugin_entry_fn)(uint32_t host_abi_version);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STRATEGY_PLUGIN_H